@@ -319,12 +319,3 @@ void OPL_ClearCallbacks(void)
         driver->clear_callbacks_func();
     }
 }
-
-void OPL_AdjustCallbacks(float value)
-{
-    if (driver != NULL)
-    {
-        driver->adjust_callbacks_func(value);
-    }
-}
-
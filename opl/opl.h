@@ -73,6 +73,9 @@ typedef enum
 
 extern int num_opl_chips;
 
+// [Nugget] Non-zero to render chips on worker threads
+extern int opl_parallel_chips;
+
 //
 // Low-level functions.
 //
@@ -118,11 +121,6 @@ void OPL_InitRegisters(int opl3);
 
 void OPL_SetCallback(uint64_t us, opl_callback_t callback, void *data);
 
-// Adjust callback times by the specified factor. For example, a value of
-// 0.5 will halve all remaining times.
-
-void OPL_AdjustCallbacks(float factor);
-
 // Clear all OPL callbacks that have been set.
 
 void OPL_ClearCallbacks(void);
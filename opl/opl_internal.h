@@ -29,7 +29,6 @@ typedef void (*opl_set_callback_func)(uint64_t us,
                                       opl_callback_t callback,
                                       void *data);
 typedef void (*opl_clear_callbacks_func)(void);
-typedef void (*opl_adjust_callbacks_func)(float value);
 
 typedef struct
 {
@@ -41,7 +40,6 @@ typedef struct
     opl_write_port_func write_port_func;
     opl_set_callback_func set_callback_func;
     opl_clear_callbacks_func clear_callbacks_func;
-    opl_adjust_callbacks_func adjust_callbacks_func;
 } opl_driver_t;
 
 extern opl_driver_t opl_sdl_driver;
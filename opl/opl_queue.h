@@ -34,8 +34,6 @@ void OPL_Queue_Push(opl_callback_queue_t *queue,
 int OPL_Queue_Pop(opl_callback_queue_t *queue,
                   opl_callback_t *callback, void **data);
 uint64_t OPL_Queue_Peek(opl_callback_queue_t *queue);
-void OPL_Queue_AdjustCallbacks(opl_callback_queue_t *queue,
-                               uint64_t time, float factor);
 
 #endif /* #ifndef OPL_QUEUE_H */
 
@@ -16,6 +16,9 @@
 //
 
 #include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
 
 #include "doomtype.h"
 #include "opl.h"
@@ -72,6 +75,45 @@ static opl_timer_t timer2 = { 3125, 0, 0, 0 };
 
 static int mixing_channels;
 
+// [Nugget] /-----------------------------------------------------------------
+
+// Chips are rendered a block at a time into their own buffers, and then
+// mixed in a single pass. Nothing but the emulator's buffered register
+// writes changes a chip between callbacks, so each chip's block can be
+// generated independently of the others.
+
+#define OPL_BLOCK_SAMPLES 512
+
+// Blocks shorter than this aren't worth handing over to worker threads
+#define OPL_PARALLEL_MIN_SAMPLES 128
+
+int opl_parallel_chips = 1;
+
+typedef struct
+{
+    int chip;
+    int nsamples;
+} chip_job_t;
+
+static Bit16s chip_buffers[OPL_MAX_CHIPS][OPL_BLOCK_SAMPLES * 2];
+static chip_job_t chip_jobs[OPL_MAX_CHIPS];
+
+// The chips are rendered by threads of their own rather than by the shared
+// worker pool, so that the audio deadline doesn't depend on unrelated jobs
+typedef struct
+{
+    SDL_Thread *thread;
+    SDL_sem *start, *finished;
+    int chips[OPL_MAX_CHIPS];
+    int num_chips;
+} chip_worker_t;
+
+static chip_worker_t chip_workers[OPL_MAX_CHIPS - 1];
+static int num_chip_workers;
+static boolean chip_workers_quit;
+
+// [Nugget] -----------------------------------------------------------------/
+
 // Advance time by the specified number of samples, invoking any
 // callback functions as appropriate.
 
@@ -141,6 +183,217 @@ static void ResyncChip (int chip)
 }
 
 
+// [Nugget] /-----------------------------------------------------------------
+
+// Run the chip if it's active or if it has pending register writes
+
+inline static boolean ChipRunning(int c)
+{
+    return opl_chip_timeouts[c] < OPL_CHIP_TIMEOUT
+           || (opl_chips[c].writebuf[opl_chips[c].writebuf_cur].reg & 0x200);
+}
+
+static void RenderChipBlock(void *data)
+{
+    const chip_job_t *job = data;
+    const int c = job->chip;
+    opl3_chip *const chip = &opl_chips[c];
+    Bit16s *out = chip_buffers[c];
+
+    for (int s = 0; s < job->nsamples; ++s, out += 2)
+    {
+        // Reset chip timeout if any channels are active
+        if (opl_chip_keys[c])
+            opl_chip_timeouts[c] = 0;
+
+        if (ChipRunning(c))
+        {
+            OPL3_Generate(chip, out);
+
+            // Reset chip timeout if it breaks the silence threshold
+            if (MAX(abs(out[0]), abs(out[1])) > OPL_SILENCE_THRESHOLD)
+                opl_chip_timeouts[c] = 0;
+            else
+                opl_chip_timeouts[c]++;
+        }
+        else
+        {
+            out[0] = out[1] = 0;
+        }
+    }
+}
+
+static void GenerateBlock(Bit16s *cursor, int nsamples)
+{
+    int active[OPL_MAX_CHIPS];
+    int num_active = 0;
+    Bit32s mix[OPL_BLOCK_SAMPLES * 2];
+
+    // Check for chip activations before we generate the block
+    for (int c = 0; c < num_opl_chips; ++c)
+    {
+        if (opl_chip_keys[c])
+        {
+            // Resync is necessary if the chip was idle
+            if (opl_chip_timeouts[c] >= OPL_CHIP_TIMEOUT)
+                ResyncChip(c);
+            opl_chip_timeouts[c] = 0;
+        }
+
+        // Idle chips stay idle until the next callback
+        if (ChipRunning(c))
+        {
+            chip_jobs[c].chip = c;
+            chip_jobs[c].nsamples = nsamples;
+            active[num_active++] = c;
+        }
+    }
+
+    if (num_active > 1 && opl_parallel_chips
+        && nsamples >= OPL_PARALLEL_MIN_SAMPLES && num_chip_workers)
+    {
+        const int num_threads = MIN(num_active, num_chip_workers + 1);
+
+        for (int w = 0; w < num_chip_workers; ++w)
+        {
+            chip_workers[w].num_chips = 0;
+        }
+
+        // Every `num_threads`th chip, starting with the first, is kept for
+        // this thread
+        for (int i = 0; i < num_active; ++i)
+        {
+            const int w = i % num_threads - 1;
+
+            if (w >= 0)
+            {
+                chip_worker_t *const worker = &chip_workers[w];
+                worker->chips[worker->num_chips++] = active[i];
+            }
+        }
+
+        for (int w = 0; w < num_threads - 1; ++w)
+        {
+            SDL_SemPost(chip_workers[w].start);
+        }
+
+        for (int i = 0; i < num_active; i += num_threads)
+        {
+            RenderChipBlock(&chip_jobs[active[i]]);
+        }
+
+        for (int w = 0; w < num_threads - 1; ++w)
+        {
+            SDL_SemWait(chip_workers[w].finished);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < num_active; ++i)
+        {
+            RenderChipBlock(&chip_jobs[active[i]]);
+        }
+    }
+
+    // Mix the chips; plain loops over flat arrays, for the compiler to
+    // vectorize
+    if (!num_active)
+    {
+        memset(cursor, 0, nsamples * 2 * sizeof(*cursor));
+        return;
+    }
+
+    for (int i = 0; i < nsamples * 2; ++i)
+    {
+        mix[i] = chip_buffers[active[0]][i];
+    }
+
+    for (int c = 1; c < num_active; ++c)
+    {
+        const Bit16s *const in = chip_buffers[active[c]];
+
+        for (int i = 0; i < nsamples * 2; ++i)
+        {
+            mix[i] += in[i];
+        }
+    }
+
+    for (int i = 0; i < nsamples * 2; ++i)
+    {
+        cursor[i] = BETWEEN(-32768, 32767, mix[i]);
+    }
+}
+
+static int ChipWorkerThread(void *data)
+{
+    chip_worker_t *const worker = data;
+
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+
+    while (true)
+    {
+        SDL_SemWait(worker->start);
+
+        if (chip_workers_quit)
+        {
+            break;
+        }
+
+        for (int i = 0; i < worker->num_chips; ++i)
+        {
+            RenderChipBlock(&chip_jobs[worker->chips[i]]);
+        }
+
+        SDL_SemPost(worker->finished);
+    }
+
+    return 0;
+}
+
+static void StopChipWorkers(void)
+{
+    chip_workers_quit = true;
+
+    for (int w = 0; w < num_chip_workers; ++w)
+    {
+        SDL_SemPost(chip_workers[w].start);
+        SDL_WaitThread(chip_workers[w].thread, NULL);
+        SDL_DestroySemaphore(chip_workers[w].start);
+        SDL_DestroySemaphore(chip_workers[w].finished);
+    }
+
+    num_chip_workers = 0;
+    chip_workers_quit = false;
+}
+
+// One thread per chip beyond the first, as far as there are cores for them
+static void StartChipWorkers(void)
+{
+    const int count = MIN(num_opl_chips, SDL_GetCPUCount()) - 1;
+
+    for (num_chip_workers = 0; num_chip_workers < count; ++num_chip_workers)
+    {
+        chip_worker_t *const worker = &chip_workers[num_chip_workers];
+
+        worker->start = SDL_CreateSemaphore(0);
+        worker->finished = SDL_CreateSemaphore(0);
+        worker->thread = (worker->start && worker->finished)
+                         ? SDL_CreateThread(ChipWorkerThread, "opl", worker)
+                         : NULL;
+
+        if (!worker->thread)
+        {
+            if (worker->start)
+                SDL_DestroySemaphore(worker->start);
+            if (worker->finished)
+                SDL_DestroySemaphore(worker->finished);
+            break;
+        }
+    }
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 // Callback function to fill a new sound buffer:
 
 int OPL_FillBuffer(byte *buffer, int buffer_samples)
@@ -178,48 +431,16 @@ int OPL_FillBuffer(byte *buffer, int buffer_samples)
         }
 
         // Add emulator output to buffer.
+        // [Nugget] Rendered in blocks
         Bit16s *cursor = (Bit16s *)(buffer + filled * 4);
-        for (int s = 0; s < nsamples; ++s)
+        for (int s = 0; s < nsamples; s += OPL_BLOCK_SAMPLES)
         {
-            // Check for chip activations before we generate the sample
-            for (int c = 0; c < num_opl_chips; ++c)
-            {
-                // Reset chip timeout if any channels are active
-                if (opl_chip_keys[c])
-                {
-                    // Resync is necessary if the chip was idle
-                    if (opl_chip_timeouts[c] >= OPL_CHIP_TIMEOUT)
-                        ResyncChip(c);
-                    opl_chip_timeouts[c] = 0;
-                }
-            }
-
-            // Generate a sample from each chip and mix them
-            Bit32s mix[2] = {0, 0};
-            for (int c = 0; c < num_opl_chips; ++c)
-            {
-                // Run the chip if it's active or if it has pending register writes
-                if (opl_chip_timeouts[c] < OPL_CHIP_TIMEOUT || (opl_chips[c].writebuf[opl_chips[c].writebuf_cur].reg & 0x200))
-                {
-                    Bit16s sample[2];
-                    OPL3_Generate(&opl_chips[c], sample);
-                    mix[0] += sample[0];
-                    mix[1] += sample[1];
-
-                    // Reset chip timeout if it breaks the silence threshold
-                    if (MAX(abs(sample[0]), abs(sample[1])) > OPL_SILENCE_THRESHOLD)
-                        opl_chip_timeouts[c] = 0;
-                    else
-                        opl_chip_timeouts[c]++;
-                }
-            }
+            const int block = MIN(OPL_BLOCK_SAMPLES, (int)nsamples - s);
 
-            cursor[0] = BETWEEN(-32768, 32767, mix[0]);
-            cursor[1] = BETWEEN(-32768, 32767, mix[1]);
-            cursor += 2;
+            GenerateBlock(cursor, block);
+            cursor += block * 2;
         }
 
-        //OPL3_GenerateStream(&opl_chip, (Bit16s *)(buffer + filled * 4), nsamples);
         filled += nsamples;
 
         // Invoke callbacks for this point in time.
@@ -232,6 +453,8 @@ int OPL_FillBuffer(byte *buffer, int buffer_samples)
 
 static void OPL_SDL_Shutdown(void)
 {
+    StopChipWorkers(); // [Nugget]
+
     OPL_Queue_Destroy(callback_queue);
 
 /*
@@ -270,6 +493,8 @@ static int OPL_SDL_Init(unsigned int port_base, int num_chips)
         opl_chip_timeouts[c] = OPL_CHIP_TIMEOUT;
     }
 
+    StartChipWorkers(); // [Nugget]
+
     return 1;
 }
 
@@ -413,11 +638,6 @@ static void OPL_SDL_ClearCallbacks(void)
     OPL_Queue_Clear(callback_queue);
 }
 
-static void OPL_SDL_AdjustCallbacks(float factor)
-{
-    OPL_Queue_AdjustCallbacks(callback_queue, current_time, factor);
-}
-
 opl_driver_t opl_sdl_driver =
 {
     "SDL",
@@ -427,6 +647,5 @@ opl_driver_t opl_sdl_driver =
     OPL_SDL_PortWrite,
     OPL_SDL_SetCallback,
     OPL_SDL_ClearCallbacks,
-    OPL_SDL_AdjustCallbacks,
 };
 
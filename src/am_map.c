@@ -29,6 +29,7 @@
 #include "doomstat.h"
 #include "doomtype.h"
 #include "i_video.h"
+#include "m_bbox.h"
 #include "m_config.h"
 #include "m_input.h"
 #include "mn_menu.h"
@@ -1766,54 +1767,122 @@ static void AM_drawFline_Smooth(fline_t *fl, int color)
    x = fl->a.x;
    y = fl->a.y;
 
-   if(dy > dx)
+   // [Nugget] When the line and the pixels next to it are all within the
+   // frame, walk a pointer across the buffer instead of plotting every dot
+   if (f_x <= MIN(fl->a.x, fl->b.x) - 1 && MAX(fl->a.x, fl->b.x) + 1 < f_x + f_w
+       && f_y <= fl->a.y && fl->b.y + 1 < f_y + f_h)
    {
-      // line is y-axis major.
-      uint16_t erroracc = 0,
-         erroradj = (uint16_t)(((uint32_t)dx << 16) / (uint32_t)dy);
+      int step = xdir;
+      byte *dest;
 
-      while(--dy)
+      if (STRICTMODE(flip_levels)) // [Nugget] Flip levels
       {
-         uint16_t erroracctmp = erroracc;
+         x = f_x*2 + f_w - 1 - x;
+         step = -step;
+      }
+
+      dest = &I_VideoBuffer[y * video.pitch + x];
+
+      #define BLENDWU(d, w) \
+      { \
+         unsigned int c = (Col2RGB8[(w)][color] + Col2RGB8[64 - (w)][*(d)]) | 0x1f07c1f; \
+         *(d) = RGB32k[0][0][c & (c >> 15)]; \
+      }
+
+      if(dy > dx)
+      {
+         uint16_t erroracc = 0,
+            erroradj = (uint16_t)(((uint32_t)dx << 16) / (uint32_t)dy);
+
+         while(--dy)
+         {
+            uint16_t erroracctmp = erroracc;
 
-         erroracc += erroradj;
+            erroracc += erroradj;
 
-         // if error has overflown, advance x coordinate
-         if(erroracc <= erroracctmp)
-            x += xdir;
+            if(erroracc <= erroracctmp)
+               dest += step;
 
-         y += 1; // advance y
+            dest += video.pitch;
 
-         // the trick is in the trig!
-         AM_putWuDot(x, y, color,
-                     finecosine[erroracc >> wu_fineshift] >> wu_fixedshift);
-         AM_putWuDot(x + xdir, y, color,
-                     finesine[erroracc >> wu_fineshift] >> wu_fixedshift);
+            BLENDWU(dest, finecosine[erroracc >> wu_fineshift] >> wu_fixedshift);
+            BLENDWU(dest + step, finesine[erroracc >> wu_fineshift] >> wu_fixedshift);
+         }
       }
+      else
+      {
+         uint16_t erroracc = 0,
+            erroradj = (uint16_t)(((uint32_t)dy << 16) / (uint32_t)dx);
+
+         while(--dx)
+         {
+            uint16_t erroracctmp = erroracc;
+
+            erroracc += erroradj;
+
+            if(erroracc <= erroracctmp)
+               dest += video.pitch;
+
+            dest += step;
+
+            BLENDWU(dest, finecosine[erroracc >> wu_fineshift] >> wu_fixedshift);
+            BLENDWU(dest + video.pitch, finesine[erroracc >> wu_fineshift] >> wu_fixedshift);
+         }
+      }
+
+      #undef BLENDWU
    }
    else
    {
-      // line is x-axis major.
-      uint16_t erroracc = 0,
-         erroradj = (uint16_t)(((uint32_t)dy << 16) / (uint32_t)dx);
+      if(dy > dx)
+      {
+         // line is y-axis major.
+         uint16_t erroracc = 0,
+            erroradj = (uint16_t)(((uint32_t)dx << 16) / (uint32_t)dy);
+
+         while(--dy)
+         {
+            uint16_t erroracctmp = erroracc;
+
+            erroracc += erroradj;
 
-      while(--dx)
+            // if error has overflown, advance x coordinate
+            if(erroracc <= erroracctmp)
+               x += xdir;
+
+            y += 1; // advance y
+
+            // the trick is in the trig!
+            AM_putWuDot(x, y, color,
+                        finecosine[erroracc >> wu_fineshift] >> wu_fixedshift);
+            AM_putWuDot(x + xdir, y, color,
+                        finesine[erroracc >> wu_fineshift] >> wu_fixedshift);
+         }
+      }
+      else
       {
-         uint16_t erroracctmp = erroracc;
+         // line is x-axis major.
+         uint16_t erroracc = 0,
+            erroradj = (uint16_t)(((uint32_t)dy << 16) / (uint32_t)dx);
+
+         while(--dx)
+         {
+            uint16_t erroracctmp = erroracc;
 
-         erroracc += erroradj;
+            erroracc += erroradj;
 
-         // if error has overflown, advance y coordinate
-         if(erroracc <= erroracctmp)
-            y += 1;
+            // if error has overflown, advance y coordinate
+            if(erroracc <= erroracctmp)
+               y += 1;
 
-         x += xdir; // advance x
+            x += xdir; // advance x
 
-         // the trick is in the trig!
-         AM_putWuDot(x, y, color,
-                     finecosine[erroracc >> wu_fineshift] >> wu_fixedshift);
-         AM_putWuDot(x, y + 1, color,
-                     finesine[erroracc >> wu_fineshift] >> wu_fixedshift);
+            // the trick is in the trig!
+            AM_putWuDot(x, y, color,
+                        finecosine[erroracc >> wu_fineshift] >> wu_fixedshift);
+            AM_putWuDot(x, y + 1, color,
+                        finesine[erroracc >> wu_fineshift] >> wu_fixedshift);
+         }
       }
    }
 
@@ -2039,6 +2108,283 @@ static int AM_isTagFinderLine(const line_t *const line)
 
 // [Nugget] -----------------------------------------------------------------/
 
+// [Nugget] Line culling and transform caching /------------------------------
+
+// Lines are sorted into a coarse grid once per level, so that only those near
+// the visible part of the map are walked; on huge maps, the minimap and a
+// zoomed-in automap only ever touch a few cells
+
+#define LINEGRID_MAX_CELLS 128 // Per axis
+#define LINEGRID_MIN_CELL_SIZE (128 << MAPBITS)
+
+// Tag Finder crossmarks are drawn around line vertices
+#define LINEGRID_MARGIN (2 * (128 << MAPBITS))
+
+static struct
+{
+  int64_t orgx, orgy;
+  int64_t cellsize;
+  int width, height;
+
+  int *cellstart; // width*height + 1 offsets into `celllines`
+  int *celllines;
+} linegrid;
+
+static int *visible_lines;
+static unsigned int *line_stamps, line_stamp;
+
+// Transformed vertices, valid while the rotation and center don't change
+static mpoint_t *vertex_cache;
+static unsigned int *vertex_stamps, vertex_stamp;
+
+static struct
+{
+  boolean rotate, aspect;
+  angle_t angle;
+  mpoint_t center;
+} transform_key;
+
+static void AM_lineBounds(const line_t *line, int64_t box[4])
+{
+  box[BOXLEFT]   = MIN(line->v1->x, line->v2->x) >> FRACTOMAPBITS;
+  box[BOXRIGHT]  = MAX(line->v1->x, line->v2->x) >> FRACTOMAPBITS;
+  box[BOXBOTTOM] = MIN(line->v1->y, line->v2->y) >> FRACTOMAPBITS;
+  box[BOXTOP]    = MAX(line->v1->y, line->v2->y) >> FRACTOMAPBITS;
+}
+
+// Converts a box in map coords to a range of cells; false if it misses the grid
+static boolean AM_gridCells(const int64_t box[4], int *x1, int *y1, int *x2, int *y2)
+{
+  if (   box[BOXRIGHT] < linegrid.orgx || box[BOXTOP] < linegrid.orgy
+      || (box[BOXLEFT]   - linegrid.orgx) / linegrid.cellsize >= linegrid.width
+      || (box[BOXBOTTOM] - linegrid.orgy) / linegrid.cellsize >= linegrid.height)
+  {
+    return false;
+  }
+
+  *x1 = MAX(box[BOXLEFT]   - linegrid.orgx, 0) / linegrid.cellsize;
+  *y1 = MAX(box[BOXBOTTOM] - linegrid.orgy, 0) / linegrid.cellsize;
+  *x2 = MIN((box[BOXRIGHT] - linegrid.orgx) / linegrid.cellsize, linegrid.width  - 1);
+  *y2 = MIN((box[BOXTOP]   - linegrid.orgy) / linegrid.cellsize, linegrid.height - 1);
+
+  return true;
+}
+
+static void AM_buildLineGrid(void)
+{
+  int64_t bounds[4] = {0}, box[4];
+  int numcells, x1, y1, x2, y2;
+
+  for (int i = 0;  i < numlines;  i++)
+  {
+    AM_lineBounds(&lines[i], box);
+
+    if (!i) { memcpy(bounds, box, sizeof(bounds)); }
+
+    bounds[BOXLEFT]   = MIN(bounds[BOXLEFT],   box[BOXLEFT]);
+    bounds[BOXRIGHT]  = MAX(bounds[BOXRIGHT],  box[BOXRIGHT]);
+    bounds[BOXBOTTOM] = MIN(bounds[BOXBOTTOM], box[BOXBOTTOM]);
+    bounds[BOXTOP]    = MAX(bounds[BOXTOP],    box[BOXTOP]);
+  }
+
+  linegrid.orgx = bounds[BOXLEFT];
+  linegrid.orgy = bounds[BOXBOTTOM];
+
+  linegrid.cellsize = MAX(LINEGRID_MIN_CELL_SIZE,
+                          MAX(bounds[BOXRIGHT] - bounds[BOXLEFT],
+                              bounds[BOXTOP] - bounds[BOXBOTTOM])
+                          / LINEGRID_MAX_CELLS + 1);
+
+  linegrid.width  = (bounds[BOXRIGHT] - bounds[BOXLEFT])   / linegrid.cellsize + 1;
+  linegrid.height = (bounds[BOXTOP]   - bounds[BOXBOTTOM]) / linegrid.cellsize + 1;
+
+  numcells = linegrid.width * linegrid.height;
+
+  // Freed along with the level, which tells us to build the grid again
+  Z_Calloc(numcells + 1, sizeof(*linegrid.cellstart), PU_LEVEL,
+           (void **) &linegrid.cellstart);
+
+  // Count the lines in every cell, and turn the counts into the cells' ends
+  for (int i = 0;  i < numlines;  i++)
+  {
+    AM_lineBounds(&lines[i], box);
+    AM_gridCells(box, &x1, &y1, &x2, &y2);
+
+    for (int y = y1;  y <= y2;  y++)
+      for (int x = x1;  x <= x2;  x++)
+        linegrid.cellstart[y * linegrid.width + x]++;
+  }
+
+  for (int c = 1;  c < numcells;  c++)
+  {
+    linegrid.cellstart[c] += linegrid.cellstart[c - 1];
+  }
+
+  linegrid.cellstart[numcells] = linegrid.cellstart[numcells - 1];
+
+  Z_Malloc(linegrid.cellstart[numcells] * sizeof(*linegrid.celllines),
+           PU_LEVEL, (void **) &linegrid.celllines);
+
+  // Fill the cells back to front, which leaves every offset at its cell's
+  // start and the lines of every cell in ascending order
+  for (int i = numlines - 1;  i >= 0;  i--)
+  {
+    AM_lineBounds(&lines[i], box);
+    AM_gridCells(box, &x1, &y1, &x2, &y2);
+
+    for (int y = y1;  y <= y2;  y++)
+      for (int x = x1;  x <= x2;  x++)
+        linegrid.celllines[--linegrid.cellstart[y * linegrid.width + x]] = i;
+  }
+
+  Z_Calloc(numlines, sizeof(*line_stamps), PU_LEVEL, (void **) &line_stamps);
+  line_stamp = 0;
+
+  Z_Malloc(numvertexes * sizeof(*vertex_cache), PU_LEVEL, (void **) &vertex_cache);
+  Z_Calloc(numvertexes, sizeof(*vertex_stamps), PU_LEVEL, (void **) &vertex_stamps);
+  vertex_stamp = 1;
+}
+
+static int AM_compareLines(const void *a, const void *b)
+{
+  return *(const int *) a - *(const int *) b;
+}
+
+// Returns the indices of the lines that may be visible, in ascending order to
+// keep the drawing order, or NULL if all of them may be
+static const int *AM_findVisibleLines(int *count)
+{
+  const angle_t angle = FOLLOW ? ANG90 - viewangle : mapangle;
+  const int64_t cornersx[4] = { m_x, m_x2, m_x,  m_x2 },
+                cornersy[4] = { m_y, m_y,  m_y2, m_y2 };
+
+  int64_t box[4] = { INT64_MIN, INT64_MAX, INT64_MAX, INT64_MIN };
+  int x1, y1, x2, y2;
+
+  if (!linegrid.cellstart) { AM_buildLineGrid(); }
+
+  // Undo AM_transformPoint() on the corners of the window
+  for (int i = 0;  i < 4;  i++)
+  {
+    int64_t x = cornersx[i], y = cornersy[i];
+
+    if (ADJUST_ASPECT_RATIO)
+    {
+      y = mapcenter.y + 6 * (y - mapcenter.y) / 5;
+    }
+
+    if (automaprotate)
+    {
+      x -= mapcenter.x;
+      y -= mapcenter.y;
+      AM_rotate(&x, &y, 0 - angle);
+      x += mapcenter.x;
+      y += mapcenter.y;
+    }
+
+    box[BOXLEFT]   = MIN(box[BOXLEFT],   x - LINEGRID_MARGIN);
+    box[BOXRIGHT]  = MAX(box[BOXRIGHT],  x + LINEGRID_MARGIN);
+    box[BOXBOTTOM] = MIN(box[BOXBOTTOM], y - LINEGRID_MARGIN);
+    box[BOXTOP]    = MAX(box[BOXTOP],    y + LINEGRID_MARGIN);
+  }
+
+  if (!AM_gridCells(box, &x1, &y1, &x2, &y2))
+  {
+    *count = 0;
+    return NULL;
+  }
+
+  if (!x1 && !y1 && x2 == linegrid.width - 1 && y2 == linegrid.height - 1)
+  {
+    *count = numlines;
+    return NULL;
+  }
+
+  // Lines spanning several cells are only taken once
+  if (!++line_stamp)
+  {
+    memset(line_stamps, 0, numlines * sizeof(*line_stamps));
+    line_stamp = 1;
+  }
+
+  array_clear(visible_lines);
+
+  for (int y = y1;  y <= y2;  y++)
+  {
+    for (int x = x1;  x <= x2;  x++)
+    {
+      const int c = y * linegrid.width + x;
+
+      for (int j = linegrid.cellstart[c];  j < linegrid.cellstart[c + 1];  j++)
+      {
+        const int i = linegrid.celllines[j];
+
+        if (line_stamps[i] != line_stamp)
+        {
+          line_stamps[i] = line_stamp;
+          array_push(visible_lines, i);
+        }
+      }
+    }
+  }
+
+  *count = array_size(visible_lines);
+
+  if (*count)
+  {
+    qsort(visible_lines, *count, sizeof(*visible_lines), AM_compareLines);
+  }
+
+  return visible_lines;
+}
+
+static void AM_updateTransformCache(void)
+{
+  const boolean rotate = automaprotate, aspect = ADJUST_ASPECT_RATIO;
+  const angle_t angle = rotate ? (FOLLOW ? ANG90 - viewangle : mapangle) : 0;
+
+  if (   transform_key.rotate != rotate || transform_key.aspect != aspect
+      || transform_key.angle != angle
+      || ((rotate || aspect) && (   transform_key.center.x != mapcenter.x
+                                 || transform_key.center.y != mapcenter.y)))
+  {
+    transform_key.rotate = rotate;
+    transform_key.aspect = aspect;
+    transform_key.angle = angle;
+    transform_key.center = mapcenter;
+
+    if (!++vertex_stamp)
+    {
+      memset(vertex_stamps, 0, numvertexes * sizeof(*vertex_stamps));
+      vertex_stamp = 1;
+    }
+  }
+}
+
+static void AM_transformVertex(const vertex_t *v, mpoint_t *pt)
+{
+  const int i = v - vertexes;
+
+  if (!(automaprotate || ADJUST_ASPECT_RATIO))
+  {
+    pt->x = v->x >> FRACTOMAPBITS;
+    pt->y = v->y >> FRACTOMAPBITS;
+    return;
+  }
+
+  if (vertex_stamps[i] != vertex_stamp)
+  {
+    vertex_cache[i].x = v->x >> FRACTOMAPBITS;
+    vertex_cache[i].y = v->y >> FRACTOMAPBITS;
+    AM_transformPoint(&vertex_cache[i]);
+    vertex_stamps[i] = vertex_stamp;
+  }
+
+  *pt = vertex_cache[i];
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 static void AM_drawWalls(void)
 {
   int i;
@@ -2057,15 +2403,20 @@ static void AM_drawWalls(void)
 
   // [Nugget] ---------------------------------------------------------------/
 
+  // [Nugget] Line culling and transform caching
+  int numvisible;
+  const int *const visible = AM_findVisibleLines(&numvisible);
+
+  AM_updateTransformCache();
+
   // draw the unclipped visible portions of all lines
-  for (i=0;i<numlines;i++)
-  {
-    l.a.x = lines[i].v1->x >> FRACTOMAPBITS;
-    l.a.y = lines[i].v1->y >> FRACTOMAPBITS;
-    l.b.x = lines[i].v2->x >> FRACTOMAPBITS;
-    l.b.y = lines[i].v2->y >> FRACTOMAPBITS;
-    AM_transformPoint(&l.a);
-    AM_transformPoint(&l.b);
+  for (int v = 0;  v < numvisible;  v++)
+  {
+    i = visible ? visible[v] : v; // [Nugget]
+
+    // [Nugget] Transformed vertices are cached
+    AM_transformVertex(lines[i].v1, &l.a);
+    AM_transformVertex(lines[i].v2, &l.b);
 
     // [Nugget] Tag Finder from PrBoomX: Highlight sectors and lines /--------
 
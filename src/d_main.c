@@ -60,6 +60,7 @@
 #include "m_input.h"
 #include "m_io.h"
 #include "mn_menu.h"
+#include "mn_snapshot.h" // [Nugget]
 #include "m_misc.h"
 #include "m_swap.h"
 #include "net_client.h"
@@ -90,7 +91,10 @@
 
 // [Nugget]
 #include <time.h>
+#include "i_capture.h"
+#include "i_thread.h"
 #include "m_nughud.h"
+#include "m_perf.h"
 
 // DEHacked support - Ty 03/09/97
 // killough 10/98:
@@ -284,6 +288,10 @@ void D_Display (void)
   if (nodrawers)                    // for comparative timing / profiling
     return;
 
+  // [Nugget] Savegame thumbnails come from the last frame, while it's still
+  // in the buffer at the same resolution
+  MN_SnapshotFrame();
+
   if (uncapped)
   {
     // [AM] Figure out how far into the current tic we're in as a fixed_t.
@@ -385,6 +393,8 @@ void D_Display (void)
   // [Nugget] Centralized drawer calls
   if (gamestate == GS_LEVEL)
   {
+    M_PerfStart(PERF_HUD);
+
     if (automapactive)
     {
       AM_Drawer();
@@ -394,6 +404,8 @@ void D_Display (void)
     }
 
     if (gametic) { ST_Drawer(); }
+
+    M_PerfStop(PERF_HUD);
   }
 
   // draw pause pic
@@ -2532,6 +2544,8 @@ void D_DoomMain(void)
   I_Printf(VB_INFO, "I_Init: Setting up machine state.");
   I_InitTimer();
   I_InitGamepad();
+  I_InitThreadPool(); // [Nugget]
+  I_InitCapture(); // [Nugget] Before sound, which may be rendered for it
   I_InitSound();
   I_InitMusic();
 
@@ -2744,6 +2758,8 @@ void D_DoomMain(void)
 
   // [FG] init graphics (video.widedelta) before HUD widgets
   I_InitGraphics();
+  M_InitPerf(); // [Nugget]
+  wipe_Benchmark(); // [Nugget]
   I_InitKeyboard();
 
   MN_InitMenuStrings();
@@ -106,6 +106,14 @@ typedef byte lighttable_t;
  #define NORETURN
 #endif
 
+#if defined(__GNUC__) || defined(__clang__)
+ #define ALWAYS_INLINE inline __attribute__((always_inline))
+#elif defined (_MSC_VER)
+ #define ALWAYS_INLINE __forceinline
+#else
+ #define ALWAYS_INLINE inline
+#endif
+
 // The packed attribute forces structures to be packed into the minimum
 // space necessary.  If this is not done, the compiler may align structure
 // fields differently to optimize memory access, inflating the overall
@@ -17,6 +17,7 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "doomtype.h"
@@ -30,6 +31,12 @@
 
 // [Nugget]
 #include "doomstat.h"
+#include "i_printf.h"
+#include "i_system.h"
+#include "i_thread.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "r_state.h"
 
 int wipe_speed_percentage; // [Nugget]
 
@@ -52,14 +59,104 @@ static byte *wipe_scr_start;
 static byte *wipe_scr_end;
 static byte *wipe_scr;
 
+// [Nugget] Wipes are drawn in horizontal strips, in parallel /---------------
+
+// The screen being wiped; the video buffer, except for -benchwipe
+static int wipe_pitch, wipe_unscaledw;
+static int wipe_width, wipe_height;
+
+#define MAX_WIPE_STRIPS 16
+
+typedef void (*wipestripfunc_t)(int y1, int y2);
+
+typedef struct
+{
+    wipestripfunc_t func;
+    int y1, y2;
+    boolean done;
+} wipestrip_t;
+
+static void WipeStripJob(void *data)
+{
+    wipestrip_t *strip = data;
+    strip->func(strip->y1, strip->y2);
+}
+
+static void RunInStrips(wipestripfunc_t func)
+{
+    static wipestrip_t strips[MAX_WIPE_STRIPS];
+    const int numstrips = MIN(I_NumWorkerThreads() + 1, MAX_WIPE_STRIPS);
+
+    for (int i = 0; i < numstrips; i++)
+    {
+        strips[i].func = func;
+        strips[i].y1 = wipe_height * i / numstrips;
+        strips[i].y2 = wipe_height * (i + 1) / numstrips;
+    }
+
+    // The last strip is drawn by this thread
+    for (int i = 0; i < numstrips - 1; i++)
+    {
+        strips[i].done = false;
+        I_QueueJob(WipeStripJob, &strips[i], &strips[i].done);
+    }
+
+    func(strips[numstrips - 1].y1, strips[numstrips - 1].y2);
+
+    for (int i = 0; i < numstrips - 1; i++)
+    {
+        I_WaitForJob(&strips[i].done);
+    }
+}
+
+static const byte *copy_source;
+
+static void CopyStrip(int y1, int y2)
+{
+    for (int y = y1; y < y2; y++)
+    {
+        memcpy(wipe_scr + y * wipe_pitch, copy_source + y * wipe_width,
+               wipe_width);
+    }
+}
+
+// Replaces V_PutBlock(0, 0, width, height, source)
+static void CopyScreen(const byte *source)
+{
+    copy_source = source;
+    RunInStrips(CopyStrip);
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 // [FG] cross-fading screen wipe implementation
 
 static int fade_tick;
 
+// [Nugget] Result of blending every pair of colors at the current tick,
+// indexed by [end << 8 | start]
+static byte *fade_table;
+
+static void ColorXFormStrip(int y1, int y2)
+{
+    for (int y = y1; y < y2; y++)
+    {
+        const byte *sta = wipe_scr_start + y * wipe_width;
+        const byte *end = wipe_scr_end + y * wipe_width;
+        byte *dst = wipe_scr + y * wipe_pitch;
+
+        for (int x = 0; x < wipe_width; x++)
+        {
+            dst[x] = fade_table[(end[x] << 8) | sta[x]];
+        }
+    }
+}
+
 static int wipe_initColorXForm(int width, int height, int ticks)
 {
-    V_PutBlock(0, 0, width, height, wipe_scr_start);
+    CopyScreen(wipe_scr_start); // [Nugget]
     fade_tick = 0;
+    fade_table = Z_Malloc(256 * 256, PU_STATIC, NULL); // [Nugget]
     return 0;
 }
 
@@ -74,25 +171,27 @@ static int wipe_doColorXForm(int width, int height, int ticks)
     if (!strictmode && wipe_speed_percentage != 100)
     { ticks = MAX(1, ticks * wipe_speed_percentage / 100); }
 
-    for (int y = 0; y < height; y++)
+    // [Nugget] Blend the 64K pairs of colors once, rather than every pixel
     {
-        byte *sta = wipe_scr_start + y * width;
-        byte *end = wipe_scr_end + y * width;
-        byte *dst = wipe_scr + y * video.pitch;
+        unsigned int *fg2rgb = Col2RGB8[fade_tick];
+        unsigned int *bg2rgb = Col2RGB8[64 - fade_tick];
 
-        for (int x = 0; x < width; x++)
+        for (int end = 0; end < 256; end++)
         {
-            unsigned int *fg2rgb = Col2RGB8[fade_tick];
-            unsigned int *bg2rgb = Col2RGB8[64 - fade_tick];
-            unsigned int fg, bg;
-
-            fg = fg2rgb[end[x]];
-            bg = bg2rgb[sta[x]];
-            fg = (fg + bg) | 0x1f07c1f;
-            dst[x] = RGB32k[0][0][fg & (fg >> 15)];
+            byte *row = fade_table + (end << 8);
+
+            for (int sta = 0; sta < 256; sta++)
+            {
+                unsigned int fg = fg2rgb[end], bg = bg2rgb[sta];
+
+                fg = (fg + bg) | 0x1f07c1f;
+                row[sta] = RGB32k[0][0][fg & (fg >> 15)];
+            }
         }
     }
 
+    RunInStrips(ColorXFormStrip);
+
     fade_tick += 2 * ticks;
 
     return (fade_tick > 64);
@@ -105,12 +204,24 @@ static int wipe_exit(int width, int height, int ticks)
     return 0;
 }
 
+// [Nugget]
+static int wipe_exitColorXForm(int width, int height, int ticks)
+{
+    Z_Free(fade_table);
+    return wipe_exit(width, height, ticks);
+}
+
 static int *ybuff1, *ybuff2;
 static int *curry, *prevy;
 
+// [Nugget] Screen x at which every column starts, and the screen row that
+// its top has fallen to (-1 once it's off the screen); the melt is drawn
+// row by row rather than column by column
+static int *melt_x, *melt_rows;
+
 static int wipe_initMelt(int width, int height, int ticks)
 {
-    wipe_columns = video.unscaledw / 2;
+    wipe_columns = wipe_unscaledw / 2; // [Nugget]
 
     ybuff1 = Z_Malloc(wipe_columns * sizeof(*ybuff1), PU_STATIC, NULL);
     ybuff2 = Z_Malloc(wipe_columns * sizeof(*ybuff2), PU_STATIC, NULL);
@@ -118,8 +229,18 @@ static int wipe_initMelt(int width, int height, int ticks)
     curry = ybuff1;
     prevy = ybuff2;
 
+    // [Nugget]
+    melt_x = Z_Malloc((wipe_columns + 1) * sizeof(*melt_x), PU_STATIC, NULL);
+    melt_rows = Z_Malloc(wipe_columns * sizeof(*melt_rows), PU_STATIC, NULL);
+
+    // Scale up and then down to handle arbitrary dimensions with integer math
+    for (int col = 0; col <= wipe_columns; col++)
+    {
+        melt_x[col] = col * (width * 100 / wipe_columns) / 100;
+    }
+
     // copy start screen to main screen
-    V_PutBlock(0, 0, width, height, wipe_scr_start);
+    CopyScreen(wipe_scr_start); // [Nugget]
 
     // setup initial column positions (y<0 => not ready to scroll yet)
     curry[0] = -(M_Random() % 16);
@@ -191,20 +312,56 @@ static int wipe_doMelt(int width, int height, int ticks)
     return done;
 }
 
-int wipe_renderMelt(int width, int height, int ticks)
+// [Nugget] Where the given column takes the pixels of row `y` from
+inline static const byte *MeltSource(int col, int y)
+{
+    const int row = melt_rows[col];
+
+    if (row < 0 || y < row)
+    {
+        return wipe_scr_end + y * wipe_width;
+    }
+
+    return wipe_scr_start + (y - row) * wipe_width;
+}
+
+// [Nugget] Neighboring columns that take their pixels from the same row are
+// copied in one go
+static void MeltStrip(int y1, int y2)
+{
+    for (int y = y1; y < y2; y++)
+    {
+        byte *dest = wipe_scr + y * wipe_pitch;
+
+        for (int col = 0; col < wipe_columns;)
+        {
+            const byte *source = MeltSource(col, y);
+            int next = col + 1;
+
+            while (next < wipe_columns && MeltSource(next, y) == source)
+            {
+                next++;
+            }
+
+            memcpy(dest + melt_x[col], source + melt_x[col],
+                   melt_x[next] - melt_x[col]);
+
+            col = next;
+        }
+
+        // Past the last column
+        memcpy(dest + melt_x[wipe_columns],
+               wipe_scr_end + y * wipe_width + melt_x[wipe_columns],
+               wipe_width - melt_x[wipe_columns]);
+    }
+}
+
+static int wipe_renderMelt(int width, int height, int ticks)
 {
     boolean done = true;
 
     // Scale up and then down to handle arbitrary dimensions with integer math
     int vertblocksize = height * 100 / WIPE_ROWS;
-    int horizblocksize = width * 100 / wipe_columns;
-    int currcol;
-    int currcolend;
-    int currrow;
-
-    V_UseBuffer(wipe_scr);
-    V_PutBlock(0, 0, width, height, wipe_scr_end);
-    V_RestoreBuffer();
 
     for (int col = 0; col < wipe_columns; ++col)
     {
@@ -221,45 +378,21 @@ int wipe_renderMelt(int width, int height, int ticks)
 
         if (current < 0)
         {
-            currcol = col * horizblocksize / 100;
-            currcolend = (col + 1) * horizblocksize / 100;
-            for (; currcol < currcolend; ++currcol)
-            {
-                pixel_t *source = wipe_scr_start + currcol;
-                pixel_t *dest = wipe_scr + currcol;
-
-                for (int i = 0; i < height; ++i)
-                {
-                    *dest = *source;
-                    dest += video.pitch;
-                    source += width;
-                }
-            }
+            melt_rows[col] = 0;
         }
         else if (current < WIPE_ROWS)
         {
-            currcol = col * horizblocksize / 100;
-            currcolend = (col + 1) * horizblocksize / 100;
-
-            currrow = current * vertblocksize / 100;
-
-            for (; currcol < currcolend; ++currcol)
-            {
-                pixel_t *source = wipe_scr_start + currcol;
-                pixel_t *dest = wipe_scr + currcol + (currrow * video.pitch);
-
-                for (int i = 0; i < height - currrow; ++i)
-                {
-                    *dest = *source;
-                    dest += video.pitch;
-                    source += width;
-                }
-            }
-
+            melt_rows[col] = current * vertblocksize / 100;
             done = false;
         }
+        else
+        {
+            melt_rows[col] = -1;
+        }
     }
 
+    RunInStrips(MeltStrip);
+
     return done;
 }
 
@@ -267,6 +400,8 @@ static int wipe_exitMelt(int width, int height, int ticks)
 {
     Z_Free(ybuff1);
     Z_Free(ybuff2);
+    Z_Free(melt_x); // [Nugget]
+    Z_Free(melt_rows);
     wipe_exit(width, height, ticks);
     return 0;
 }
@@ -342,9 +477,37 @@ static unsigned int rndbits_y;
 static unsigned int rndmask;
 static unsigned int lastrndval;
 
+// [Nugget] Screen position and size of every unscaled column and row,
+// looked up once rather than for every pixel
+static int *fizzle_x, *fizzle_w, *fizzle_y, *fizzle_h;
+
+static void ScaleLookup(int *start, int *size, int unscaled, int scaled)
+{
+    // Same stepping as V_Init()
+    const int64_t step = ((int64_t)unscaled << FRACBITS) / scaled + 1;
+
+    for (int i = 0; i < scaled; i++)
+    {
+        const int u = (int)((i * step) >> FRACBITS);
+
+        if (u >= unscaled)
+        {
+            break;
+        }
+
+        if (!size[u]++)
+        {
+            start[u] = i;
+        }
+    }
+
+    // The last one reaches the edge
+    size[unscaled - 1] = scaled - start[unscaled - 1];
+}
+
 static int wipe_initFizzle(int width, int height, int ticks)
 {
-    int rndbits_x = log2_ceil(video.unscaledw);
+    int rndbits_x = log2_ceil(wipe_unscaledw); // [Nugget]
     rndbits_y = log2_ceil(WIPE_ROWS);
 
     int rndbits = rndbits_x + rndbits_y;
@@ -359,7 +522,16 @@ static int wipe_initFizzle(int width, int height, int ticks)
 
     rndmask = rndmasks[rndbits - 17];
 
-    V_PutBlock(0, 0, width, height, wipe_scr_start);
+    // [Nugget]
+    fizzle_x = Z_Calloc(wipe_unscaledw, sizeof(*fizzle_x), PU_STATIC, NULL);
+    fizzle_w = Z_Calloc(wipe_unscaledw, sizeof(*fizzle_w), PU_STATIC, NULL);
+    fizzle_y = Z_Calloc(WIPE_ROWS, sizeof(*fizzle_y), PU_STATIC, NULL);
+    fizzle_h = Z_Calloc(WIPE_ROWS, sizeof(*fizzle_h), PU_STATIC, NULL);
+
+    ScaleLookup(fizzle_x, fizzle_w, wipe_unscaledw, width);
+    ScaleLookup(fizzle_y, fizzle_h, WIPE_ROWS, height);
+
+    CopyScreen(wipe_scr_start); // [Nugget]
 
     lastrndval = 0;
 
@@ -373,7 +545,7 @@ static int wipe_doFizzle(int width, int height, int ticks)
         return false;
     }
 
-    int pixperframe = (video.unscaledw * WIPE_ROWS) >> 5;
+    int pixperframe = (wipe_unscaledw * WIPE_ROWS) >> 5; // [Nugget]
     unsigned int rndval = lastrndval;
 
     // [Nugget] Screen Wipe speed
@@ -391,7 +563,7 @@ static int wipe_doFizzle(int width, int height, int ticks)
 
         rndval = (rndval >> 1) ^ (rndval & 1 ? 0 : rndmask);
 
-        if (x >= video.unscaledw || y >= WIPE_ROWS)
+        if (x >= wipe_unscaledw || y >= WIPE_ROWS) // [Nugget]
         {
             if (rndval == 0) // entire sequence has been completed
             {
@@ -403,17 +575,14 @@ static int wipe_doFizzle(int width, int height, int ticks)
         }
 
         // copy one pixel
-        vrect_t rect = {x, y, 1, 1};
-        V_ScaleRect(&rect);
+        byte *src = wipe_scr_end + fizzle_y[y] * width + fizzle_x[x];
+        byte *dest = wipe_scr + fizzle_y[y] * wipe_pitch + fizzle_x[x];
 
-        byte *src = wipe_scr_end + rect.sy * width + rect.sx;
-        byte *dest = wipe_scr + rect.sy * video.pitch + rect.sx;
-
-        while (rect.sh--)
+        for (int h = fizzle_h[y]; h > 0; h--)
         {
-            memcpy(dest, src, rect.sw);
+            memcpy(dest, src, fizzle_w[x]);
             src += width;
-            dest += video.pitch;
+            dest += wipe_pitch;
         }
 
         if (rndval == 0) // entire sequence has been completed
@@ -427,10 +596,37 @@ static int wipe_doFizzle(int width, int height, int ticks)
     return false;
 }
 
+// [Nugget]
+static int wipe_exitFizzle(int width, int height, int ticks)
+{
+    Z_Free(fizzle_x);
+    Z_Free(fizzle_w);
+    Z_Free(fizzle_y);
+    Z_Free(fizzle_h);
+    return wipe_exit(width, height, ticks);
+}
+
 // [Nugget] "Black Fade" wipe /-----------------------------------------------
 
 static boolean fadeIn;
 
+static const byte *shade_source, *shade_colormap;
+
+// Copies and darkens the screen in one pass
+static void ShadeStrip(int y1, int y2)
+{
+    for (int y = y1; y < y2; y++)
+    {
+        const byte *src = shade_source + y * wipe_width;
+        byte *dest = wipe_scr + y * wipe_pitch;
+
+        for (int x = 0; x < wipe_width; x++)
+        {
+            dest[x] = shade_colormap[src[x]];
+        }
+    }
+}
+
 static int wipe_initFade(int width, int height, int ticks)
 {
   fadeIn = false;
@@ -453,9 +649,9 @@ static int wipe_doFade(int width, int height, int ticks)
     if (!strictmode && wipe_speed_percentage != 100)
     { ticks = MAX(1, ticks * wipe_speed_percentage / 100); }
 
-    V_PutBlock(0, 0, width, height, fadeIn ? wipe_scr_end : wipe_scr_start);
-
-    V_ShadeScreen(screenshade);
+    shade_source = fadeIn ? wipe_scr_end : wipe_scr_start;
+    shade_colormap = &colormaps[0][screenshade * 256];
+    RunInStrips(ShadeStrip);
 
     if (!fadeIn)
     {
@@ -498,13 +694,13 @@ typedef struct
 } wipe_t;
 
 static wipe_t wipes[] = {
-    {wipe_NOP,            wipe_NOP,          wipe_NOP,        wipe_exit    },
-    {wipe_initMelt,       wipe_doMelt,       wipe_renderMelt, wipe_exitMelt},
-    {wipe_initColorXForm, wipe_doColorXForm, wipe_NOP,        wipe_exit    },
-    {wipe_initFizzle,     wipe_doFizzle,     wipe_NOP,        wipe_exit    },
+    {wipe_NOP,            wipe_NOP,          wipe_NOP,        wipe_exit          },
+    {wipe_initMelt,       wipe_doMelt,       wipe_renderMelt, wipe_exitMelt      },
+    {wipe_initColorXForm, wipe_doColorXForm, wipe_NOP,        wipe_exitColorXForm},
+    {wipe_initFizzle,     wipe_doFizzle,     wipe_NOP,        wipe_exitFizzle    },
 
     // [Nugget] "Black Fade" wipe
-    {wipe_initFade,       wipe_doFade,       wipe_NOP,        wipe_exit    },
+    {wipe_initFade,       wipe_doFade,       wipe_NOP,        wipe_exit          },
 };
 
 // killough 3/5/98: reformatted and cleaned up
@@ -516,6 +712,12 @@ int wipe_ScreenWipe(int wipeno, int x, int y, int width, int height, int ticks)
     {
         go = 1;
         wipe_scr = I_VideoBuffer;
+
+        // [Nugget]
+        wipe_pitch = video.pitch;
+        wipe_unscaledw = video.unscaledw;
+        wipe_width = width;
+        wipe_height = height;
         wipes[wipeno].init(width, height, ticks);
     }
 
@@ -530,6 +732,88 @@ int wipe_ScreenWipe(int wipeno, int x, int y, int width, int height, int ticks)
     return !go;
 }
 
+// [Nugget] -benchwipe /------------------------------------------------------
+
+void wipe_Benchmark(void)
+{
+    //!
+    // @category obscure
+    //
+    // Run every screen wipe to completion, one tic per frame, on offscreen
+    // buffers at several resolutions, print the average time per frame of
+    // each, and quit.
+    //
+
+    static const struct { int width, height; } resolutions[] = {
+        { 640,  400}, {1920, 1080}, {2560, 1440}, {3840, 2160},
+    };
+
+    static const char *names[] = {
+        "None", "Melt", "Crossfade", "Fizzle", "Black Fade",
+    };
+
+    if (!M_CheckParm("-benchwipe"))
+    {
+        return;
+    }
+
+    I_Printf(VB_ALWAYS, "wipe_Benchmark: %d worker thread(s)",
+             I_NumWorkerThreads());
+
+    for (int r = 0; r < arrlen(resolutions); r++)
+    {
+        const int width = resolutions[r].width, height = resolutions[r].height;
+        const int size = width * height;
+
+        wipe_scr = malloc(size);
+        wipe_pitch = wipe_width = width;
+        wipe_height = height;
+        wipe_unscaledw = width * SCREENHEIGHT / height;
+
+        for (int wipeno = wipe_Melt; wipeno < wipe_NUMWIPES; wipeno++)
+        {
+            uint64_t start;
+            int frames = 0;
+
+            wipe_scr_start = Z_Malloc(size, PU_STATIC, NULL);
+            wipe_scr_end = Z_Malloc(size, PU_STATIC, NULL);
+
+            for (int i = 0; i < size; i++)
+            {
+                wipe_scr_start[i] = M_Random();
+                wipe_scr_end[i] = M_Random();
+            }
+
+            start = I_GetTimeUS();
+
+            wipes[wipeno].init(width, height, 1);
+
+            while (!wipes[wipeno].update(width, height, 1))
+            {
+                wipes[wipeno].render(width, height, 1);
+                frames++;
+            }
+
+            wipes[wipeno].exit(width, height, 1);
+
+            const uint64_t time = I_GetTimeUS() - start;
+
+            I_Printf(VB_ALWAYS,
+                     "wipe_Benchmark: %s at %dx%d: %d frames, %.3f ms/frame",
+                     names[wipeno], width, height, frames,
+                     time / 1000.0 / MAX(frames, 1));
+        }
+
+        free(wipe_scr);
+    }
+
+    wipe_scr = NULL;
+
+    I_SafeExit(0);
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 //----------------------------------------------------------------------------
 //
 // $Log: f_wipe.c,v $
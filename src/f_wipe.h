@@ -40,6 +40,8 @@ int wipe_ScreenWipe (int wipeno,
 int wipe_StartScreen(int x, int y, int width, int height);
 int wipe_EndScreen  (int x, int y, int width, int height);
 
+void wipe_Benchmark(void); // [Nugget] -benchwipe
+
 #endif
 
 //----------------------------------------------------------------------------
@@ -63,6 +63,7 @@
 #include "m_swap.h" // [FG] LONG
 #include "memio.h"
 #include "mn_menu.h"
+#include "mn_saveindex.h" // [Nugget]
 #include "mn_snapshot.h"
 #include "net_defs.h"
 #include "p_enemy.h"
@@ -101,6 +102,8 @@
 #include "m_cheat.h"
 #include "p_spec.h"
 
+#include "miniz.h" // [Nugget] Compressed savegames
+
 #define SAVEGAMESIZE  0x20000
 #define SAVESTRINGSIZE  24
 
@@ -2758,6 +2761,151 @@ void CheckSaveGame(size_t size)
            savegamesize += (size+1023) & ~1023, PU_STATIC, 0)) + pos;
 }
 
+// [Nugget] Compressed savegames /-------------------------------------------
+
+// Layout: the description, as in plain savegames so that the menu can read
+// it, the magic, the uncompressed size of the rest of the savegame, then the
+// rest of it as a zlib stream. The snapshot is left uncompressed at the end,
+// where the menu looks for it. The magic takes the place of the version
+// string, so older versions of the game refuse these savegames.
+#define ZSAVE_MAGIC      "NUGZSAVE"
+#define ZSAVE_MAGIC_LEN  8
+#define ZSAVE_HEADER_LEN (SAVESTRINGSIZE + ZSAVE_MAGIC_LEN + 4)
+
+// Anything larger than this must come from a damaged header
+#define ZSAVE_MAX_SIZE   (256 << 20)
+
+static boolean savegame_compression; // (CFG-only)
+
+// While a compressed savegame is written, the data archived so far is
+// compressed and dropped after every part, so the buffer only has to hold
+// one part at a time
+static FILE *save_stream;
+static tdefl_compressor *save_deflate;
+// Offset of the data not compressed yet, since CheckSaveGame() may move
+// the buffer
+static size_t save_base;
+static size_t save_flushed; // Bytes compressed so far, with the description
+static boolean save_stream_error;
+
+static mz_bool PutSaveStream(const void *buf, int len, void *user)
+{
+  return fwrite(buf, 1, len, save_stream) == (size_t) len;
+}
+
+static void OpenSaveStream(const char *name)
+{
+  byte header[ZSAVE_HEADER_LEN] = {0};
+
+  if (!(save_stream = M_fopen(name, "wb")))
+    return;
+
+  save_deflate = tdefl_compressor_alloc();
+  tdefl_init(save_deflate, PutSaveStream, NULL,
+             tdefl_create_comp_flags_from_zip_params(MZ_BEST_SPEED,
+                                                     MZ_DEFAULT_WINDOW_BITS,
+                                                     MZ_DEFAULT_STRATEGY));
+
+  // The size is filled in once known
+  memcpy(header, savebuffer, SAVESTRINGSIZE);
+  memcpy(header + SAVESTRINGSIZE, ZSAVE_MAGIC, ZSAVE_MAGIC_LEN);
+  save_stream_error = fwrite(header, sizeof(header), 1, save_stream) != 1;
+
+  save_base = SAVESTRINGSIZE;
+  save_p = savebuffer + save_base;
+  save_flushed = SAVESTRINGSIZE;
+}
+
+static void CompressSaveStream(tdefl_flush flush)
+{
+  const size_t size = save_p - (savebuffer + save_base);
+
+  if (tdefl_compress_buffer(save_deflate, savebuffer + save_base, size, flush)
+      < TDEFL_STATUS_OKAY)
+    save_stream_error = true;
+
+  save_flushed += size;
+
+  // Keep the alignment that the padding in the savegame was written for
+  save_base = save_flushed & 7;
+  save_p = savebuffer + save_base;
+}
+
+boolean G_SaveGameStreaming(void)
+{
+  return save_stream != NULL;
+}
+
+void G_FlushSaveGame(void)
+{
+  if (save_stream)
+    CompressSaveStream(TDEFL_NO_FLUSH);
+}
+
+// Writes what is left in the buffer uncompressed
+static boolean CloseSaveStream(void)
+{
+  const size_t length = save_p - (savebuffer + save_base);
+  const uint32_t size = save_flushed - SAVESTRINGSIZE;
+  const byte raw[4] = {size & 0xff, (size >> 8) & 0xff, (size >> 16) & 0xff,
+                       size >> 24};
+  boolean result = !save_stream_error;
+
+  result = result
+           && fwrite(savebuffer + save_base, 1, length, save_stream) == length;
+
+  result = result
+           && !fseek(save_stream, SAVESTRINGSIZE + ZSAVE_MAGIC_LEN, SEEK_SET)
+           && fwrite(raw, sizeof(raw), 1, save_stream) == 1;
+
+  result = (fclose(save_stream) == 0) && result;
+  save_stream = NULL;
+
+  tdefl_compressor_free(save_deflate);
+  save_deflate = NULL;
+
+  return result;
+}
+
+// Replaces a compressed savegame in the buffer with its contents, laid out
+// like a plain one. Returns -1 if the savegame is damaged, leaving the
+// buffer as it was.
+static int InflateSaveGame(int length)
+{
+  const byte *raw = savebuffer + SAVESTRINGSIZE + ZSAVE_MAGIC_LEN;
+  byte *buffer;
+  size_t size;
+
+  if (length < ZSAVE_HEADER_LEN
+      || memcmp(savebuffer + SAVESTRINGSIZE, ZSAVE_MAGIC, ZSAVE_MAGIC_LEN))
+    return length;
+
+  size = raw[0] | (raw[1] << 8) | (raw[2] << 16) | ((size_t) raw[3] << 24);
+
+  if (!size || size > ZSAVE_MAX_SIZE)
+    return -1;
+
+  buffer = Z_Malloc(SAVESTRINGSIZE + size, PU_STATIC, 0);
+  memcpy(buffer, savebuffer, SAVESTRINGSIZE);
+
+  // The snapshot after the stream is left out
+  if (tinfl_decompress_mem_to_mem(buffer + SAVESTRINGSIZE, size,
+                                  savebuffer + ZSAVE_HEADER_LEN,
+                                  length - ZSAVE_HEADER_LEN,
+                                  TINFL_FLAG_PARSE_ZLIB_HEADER) != size)
+  {
+    Z_Free(buffer);
+    return -1;
+  }
+
+  Z_Free(savebuffer);
+  savebuffer = buffer;
+
+  return SAVESTRINGSIZE + size;
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 // killough 3/22/98: form savegame name in one location
 // (previously code was scattered around in multiple places)
 
@@ -2813,11 +2961,17 @@ char *G_AutoSaveName(void)
 }
 
 char *G_SaveGameName(int slot)
+{
+  return G_PageSaveGameName(savepage, slot); // [Nugget]
+}
+
+// [Nugget] For any page of savegames
+char *G_PageSaveGameName(int page, int slot)
 {
   // Ty 05/04/98 - use savegamename variable (see d_deh.c)
   // killough 12/98: add .7 to truncate savegamename
   char buf[16] = {0};
-  sprintf(buf, "%.7s%d.dsg", savegamename, 10 * savepage + slot);
+  sprintf(buf, "%.7s%d.dsg", savegamename, 10 * page + slot);
   return SaveGameName(buf);
 }
 
@@ -2870,6 +3024,8 @@ static void DoSaveGame(char *name)
   char name2[VERSIONSIZE];
   char *description;
   int  length, i;
+  boolean saved; // [Nugget]
+  const uint64_t save_start = I_GetTimeUS(); // [Nugget]
 
   keyframe_rw = false; // [Nugget] Make sure endian-unsafe R/W is disabled
 
@@ -2880,6 +3036,10 @@ static void DoSaveGame(char *name)
   CheckSaveGame(SAVESTRINGSIZE+VERSIONSIZE+sizeof(uint64_t));
   memcpy (save_p, description, SAVESTRINGSIZE);
   save_p += SAVESTRINGSIZE;
+
+  // [Nugget] Compressed savegames
+  if (savegame_compression)
+    OpenSaveStream(name);
   memset (name2,0,sizeof(name2));
 
   // killough 2/22/98: "proprietary" version string :-)
@@ -2933,10 +3093,15 @@ static void DoSaveGame(char *name)
   // killough 11/98: save revenant tracer state
   *save_p++ = (gametic-basetic) & 255;
 
+  // [Nugget] Compressed savegames: flush after each part
   P_ArchivePlayers();
+  G_FlushSaveGame();
   P_ArchiveWorld();
+  G_FlushSaveGame();
   P_ArchiveThinkers();
+  G_FlushSaveGame();
   P_ArchiveSpecials();
+  G_FlushSaveGame();
   P_ArchiveRNG();    // killough 1/18/98: save RNG information
   P_ArchiveMap();    // killough 1/22/98: save automap information
 
@@ -3000,6 +3165,10 @@ static void DoSaveGame(char *name)
 
   // [Nugget] ===============================================================/
 
+  // [Nugget] Compressed savegames: the snapshot is left out of the stream
+  if (save_stream)
+    CompressSaveStream(TDEFL_FINISH);
+
   // [Nugget] Periodic auto save
   if (!is_periodic_autosave)
   {
@@ -3009,12 +3178,36 @@ static void DoSaveGame(char *name)
     save_p += MN_SnapshotDataSize();
   }
 
-  length = save_p - savebuffer;
+  // [Nugget] Compressed savegames
+  if (save_stream)
+  {
+    length = save_flushed + (save_p - (savebuffer + save_base));
+    saved = CloseSaveStream();
 
-  if (!M_WriteFile(name, savebuffer, length))
+    I_Printf(VB_DEBUG, "DoSaveGame: %d KB compressed to %d KB in %.1f ms",
+             length / 1024, saved ? M_FileLength(name) / 1024 : 0,
+             (I_GetTimeUS() - save_start) / 1000.0);
+  }
+  else
+  {
+    length = save_p - savebuffer;
+    saved = M_WriteFile(name, savebuffer, length);
+
+    I_Printf(VB_DEBUG, "DoSaveGame: %d KB in %.1f ms", length / 1024,
+             (I_GetTimeUS() - save_start) / 1000.0);
+  }
+
+  if (!saved)
     displaymsg("%s", errno ? strerror(errno) : "Could not save game: Error unknown");
-  else if (show_save_messages && !is_periodic_autosave) // [Nugget]
-    displaymsg("%s", s_GGSAVED);  // Ty 03/27/98 - externalized
+  else
+  {
+    // [Nugget] Keep the menu from having to read the savegame back
+    MN_UpdateSaveIndex(name, description,
+                       is_periodic_autosave ? NULL : MN_LastSnapshot());
+
+    if (show_save_messages && !is_periodic_autosave) // [Nugget]
+      displaymsg("%s", s_GGSAVED);  // Ty 03/27/98 - externalized
+  }
 
   Z_Free(savebuffer);  // killough
   savebuffer = save_p = NULL;
@@ -3058,6 +3251,7 @@ static boolean DoLoadGame(boolean do_load_autosave)
   char vcheck[VERSIONSIZE];
   uint64_t checksum;
   int tmp_compat, tmp_skill, tmp_epi, tmp_map;
+  const uint64_t load_start = I_GetTimeUS(); // [Nugget]
 
   keyframe_rw = false; // [Nugget] Make sure endian-unsafe R/W is disabled
 
@@ -3077,6 +3271,18 @@ static boolean DoLoadGame(boolean do_load_autosave)
   gameaction = ga_nothing;
 
   length = M_ReadFile(savename, &savebuffer);
+
+  // [Nugget] Compressed savegames
+  if ((length = InflateSaveGame(length)) < 0)
+    {
+      const char *msg = "Savegame could not be decompressed!\n\nAre you sure?";
+      if (do_load_autosave)
+        G_LoadAutoSaveErr(msg);
+      else
+        G_LoadGameErr(msg);
+      return false;
+    }
+
   save_p = savebuffer + SAVESTRINGSIZE;
 
   // skip the description field
@@ -3342,6 +3548,10 @@ static boolean DoLoadGame(boolean do_load_autosave)
       if (demorecording) // So this can only possibly be a -recordfrom command.
 	G_BeginRecording();// Start the -recordfrom, since the game was loaded.
 
+  // [Nugget]
+  I_Printf(VB_DEBUG, "DoLoadGame: %d KB in %.1f ms", length / 1024,
+           (I_GetTimeUS() - load_start) / 1000.0);
+
   return true;
 }
 
@@ -6007,6 +6217,10 @@ void G_BindGameVariables(void)
 
   BIND_BOOL_GENERAL(one_key_saveload, false, "One-key quick-saving/loading");
 
+  M_BindBool("savegame_compression", &savegame_compression, NULL,
+             false, ss_none, wad_no,
+             "Write compressed savegames, which older versions can't load");
+
   BIND_NUM_GENERAL(rewind_interval, 1, 1, 600,
     "Interval between rewind key-frames, in seconds");
 
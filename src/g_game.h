@@ -65,6 +65,7 @@ void G_ScreenShot(void);
 void G_ReloadDefaults(boolean keep_demover); // killough 3/1/98: loads game defaults
 char *G_AutoSaveName(void);
 char *G_SaveGameName(int); // killough 3/22/98: sets savegame filename
+char *G_PageSaveGameName(int page, int slot); // [Nugget]
 char *G_MBFSaveGameName(int); // MBF savegame filename
 void G_SetFastParms(int);        // killough 4/10/98: sets -fast parameters
 void G_DoNewGame(void);
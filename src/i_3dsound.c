@@ -380,6 +380,7 @@ const sound_module_t sound_3d_module =
     I_3D_ReinitSound,
     I_OAL_AllowReinitSound,
     I_OAL_CacheSound,
+    I_OAL_PrecacheSounds,
     I_3D_AdjustSoundParams,
     I_3D_UpdateSoundParams,
     I_3D_UpdateListenerParams,
@@ -0,0 +1,399 @@
+//
+//  Copyright(C) 2024 Alaux
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Capture of frames and sound to video files
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "i_capture.h"
+#include "i_oalsound.h"
+#include "i_printf.h"
+#include "i_system.h"
+#include "i_video.h"
+#include "m_argv.h"
+#include "m_io.h"
+#include "m_misc.h"
+
+// Frames that can be queued before the game waits for the writer
+#define CAPTURE_SLOTS 8
+
+#define SAMPLES_PER_TIC (CAPTURE_SAMPLE_RATE / TICRATE)
+
+typedef struct
+{
+    byte *pixels;
+    uint32_t palette[256];
+    int16_t audio[SAMPLES_PER_TIC * 2];
+    boolean has_audio;
+    boolean last; // Tells the writer to stop
+} capture_slot_t;
+
+// Single-producer, single-consumer ring: the game fills slots in order and
+// the writer empties them in the same order, so the semaphores are the only
+// synchronization needed
+static capture_slot_t slots[CAPTURE_SLOTS];
+static SDL_sem *free_slots, *filled_slots;
+static int write_index;
+static SDL_Thread *writer;
+
+static boolean capturing, capture_audio, y4m;
+static int frame_width, frame_height, last_tic = -1;
+
+static char *video_path, *audio_path;
+static FILE *video_file, *audio_file;
+static uint32_t audio_bytes;
+
+static byte *row_buffer;
+
+static void WriteLE(FILE *file, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        fputc((value >> (i * 8)) & 0xff, file);
+    }
+}
+
+static void WriteWAVHeader(FILE *file, uint32_t size)
+{
+    fwrite("RIFF", 1, 4, file);
+    WriteLE(file, 36 + size, 4);
+    fwrite("WAVEfmt ", 1, 8, file);
+    WriteLE(file, 16, 4);
+    WriteLE(file, 1, 2); // PCM
+    WriteLE(file, 2, 2);
+    WriteLE(file, CAPTURE_SAMPLE_RATE, 4);
+    WriteLE(file, CAPTURE_SAMPLE_RATE * 4, 4);
+    WriteLE(file, 4, 2);
+    WriteLE(file, 16, 2);
+    fwrite("data", 1, 4, file);
+    WriteLE(file, size, 4);
+}
+
+// Full-resolution chroma, BT.601 limited range
+static void WriteY4MFrame(const capture_slot_t *slot)
+{
+    const int size = frame_width * frame_height;
+    byte y[256], u[256], v[256];
+
+    for (int i = 0; i < 256; i++)
+    {
+        const int r = (slot->palette[i] >> 16) & 0xff;
+        const int g = (slot->palette[i] >> 8) & 0xff;
+        const int b = slot->palette[i] & 0xff;
+
+        y[i] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+        u[i] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+        v[i] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+    }
+
+    fputs("FRAME\n", video_file);
+
+    for (int plane = 0; plane < 3; plane++)
+    {
+        const byte *lut = plane == 0 ? y : plane == 1 ? u : v;
+
+        for (int i = 0; i < size; i++)
+        {
+            row_buffer[i] = lut[slot->pixels[i]];
+        }
+
+        fwrite(row_buffer, 1, size, video_file);
+    }
+}
+
+static void WriteRGBFrame(const capture_slot_t *slot)
+{
+    const int size = frame_width * frame_height;
+
+    for (int i = 0; i < size; i++)
+    {
+        const uint32_t argb = slot->palette[slot->pixels[i]];
+
+        row_buffer[i * 3 + 0] = (argb >> 16) & 0xff;
+        row_buffer[i * 3 + 1] = (argb >> 8) & 0xff;
+        row_buffer[i * 3 + 2] = argb & 0xff;
+    }
+
+    fwrite(row_buffer, 3, size, video_file);
+}
+
+static int WriterThread(void *unused)
+{
+    for (int index = 0;; index = (index + 1) % CAPTURE_SLOTS)
+    {
+        const capture_slot_t *slot = &slots[index];
+
+        SDL_SemWait(filled_slots);
+
+        if (slot->last)
+        {
+            break;
+        }
+
+        if (y4m)
+        {
+            WriteY4MFrame(slot);
+        }
+        else
+        {
+            WriteRGBFrame(slot);
+        }
+
+        if (audio_file && slot->has_audio)
+        {
+            // Samples are already little-endian on every platform we ship
+            fwrite(slot->audio, 1, sizeof(slot->audio), audio_file);
+            audio_bytes += sizeof(slot->audio);
+        }
+
+        SDL_SemPost(free_slots);
+    }
+
+    return 0;
+}
+
+static capture_slot_t *TakeFreeSlot(void)
+{
+    capture_slot_t *slot;
+
+    SDL_SemWait(free_slots);
+
+    slot = &slots[write_index];
+    write_index = (write_index + 1) % CAPTURE_SLOTS;
+
+    return slot;
+}
+
+static void StopCapture(void)
+{
+    const boolean started = (writer != NULL);
+
+    if (!capturing)
+    {
+        return;
+    }
+
+    capturing = false;
+
+    if (writer)
+    {
+        TakeFreeSlot()->last = true;
+        SDL_SemPost(filled_slots);
+        SDL_WaitThread(writer, NULL);
+        writer = NULL;
+    }
+
+    if (video_file)
+    {
+        fclose(video_file);
+        video_file = NULL;
+    }
+
+    if (audio_file)
+    {
+        // Now that the size is known
+        fseek(audio_file, 0, SEEK_SET);
+        WriteWAVHeader(audio_file, audio_bytes);
+        fclose(audio_file);
+        audio_file = NULL;
+    }
+
+    for (int i = 0; i < CAPTURE_SLOTS; i++)
+    {
+        free(slots[i].pixels);
+        slots[i].pixels = NULL;
+    }
+
+    free(row_buffer);
+    row_buffer = NULL;
+
+    if (started)
+    {
+        I_Printf(VB_INFO, "I_Capture: Wrote %s", video_path);
+    }
+    else
+    {
+        I_Printf(VB_WARNING, "I_Capture: No frames written to %s",
+                 video_path);
+    }
+}
+
+void I_InitCapture(void)
+{
+    //!
+    // @arg <file>
+    // @category video
+    //
+    // Capture one frame per game tic to the given file: Y4M video if its
+    // name ends with .y4m, raw 24-bit RGB frames otherwise. The sound is
+    // written to <file>.wav. Combine with -timedemo to render a demo
+    // faster than real time, and with -noblit to skip the display. Screen
+    // wipes take no game tics, so they are left out of the capture.
+    //
+
+    int p = M_CheckParmWithArgs("-capture", 1);
+
+    if (!p)
+    {
+        return;
+    }
+
+    video_path = myargv[p + 1];
+    y4m = M_StringCaseEndsWith(video_path, ".y4m");
+
+    free_slots = SDL_CreateSemaphore(CAPTURE_SLOTS);
+    filled_slots = SDL_CreateSemaphore(0);
+
+    if (!free_slots || !filled_slots)
+    {
+        I_Printf(VB_WARNING, "I_InitCapture: %s", SDL_GetError());
+        return;
+    }
+
+    video_file = M_fopen(video_path, "wb");
+
+    if (!video_file)
+    {
+        I_Printf(VB_WARNING, "I_InitCapture: Failed to open %s", video_path);
+        return;
+    }
+
+    if (!nosfxparm || !nomusicparm)
+    {
+        audio_path = M_StringJoin(video_path, ".wav");
+        audio_file = M_fopen(audio_path, "wb");
+
+        if (audio_file)
+        {
+            WriteWAVHeader(audio_file, 0);
+            capture_audio = true;
+        }
+        else
+        {
+            I_Printf(VB_WARNING, "I_InitCapture: Failed to open %s",
+                     audio_path);
+        }
+    }
+
+    capturing = true;
+    I_AtExit(StopCapture, true);
+}
+
+boolean I_CaptureActive(void)
+{
+    return capturing;
+}
+
+boolean I_CaptureAudio(void)
+{
+    return capture_audio;
+}
+
+// The writer starts with the first frame, once its size is known
+static boolean StartWriter(int width, int height)
+{
+    frame_width = width;
+    frame_height = height;
+
+    for (int i = 0; i < CAPTURE_SLOTS; i++)
+    {
+        if (!(slots[i].pixels = malloc(width * height)))
+        {
+            I_Printf(VB_WARNING, "I_Capture: Failed to allocate frames");
+            return false;
+        }
+    }
+
+    if (!(row_buffer = malloc(width * height * 3)))
+    {
+        I_Printf(VB_WARNING, "I_Capture: Failed to allocate frames");
+        return false;
+    }
+
+    if (y4m)
+    {
+        // Pixels are stretched vertically with aspect ratio correction
+        fprintf(video_file, "YUV4MPEG2 W%d H%d F%d:1 Ip A%s C444\n", width,
+                height, TICRATE, correct_aspect_ratio ? "5:6" : "1:1");
+    }
+    else
+    {
+        I_Printf(VB_INFO,
+                 "I_Capture: Writing %dx%d rgb24 frames at %d fps to %s",
+                 width, height, TICRATE, video_path);
+    }
+
+    writer = SDL_CreateThread(WriterThread, "capture", NULL);
+
+    if (!writer)
+    {
+        I_Printf(VB_WARNING, "I_Capture: %s", SDL_GetError());
+        return false;
+    }
+
+    return true;
+}
+
+void I_CaptureFrame(const byte *pixels, int pitch, int width, int height,
+                    const uint32_t *palette)
+{
+    int frames;
+
+    if (!capturing)
+    {
+        return;
+    }
+
+    if (!writer && !StartWriter(width, height))
+    {
+        StopCapture();
+        return;
+    }
+
+    if (width != frame_width || height != frame_height)
+    {
+        I_Printf(VB_WARNING, "I_Capture: Resolution changed, stopping");
+        StopCapture();
+        return;
+    }
+
+    // One frame per tic, repeating the last one over dropped frames. Frames
+    // presented without gametic advancing, such as the wipe's, are skipped.
+    frames = (last_tic < 0) ? 1 : gametic - last_tic;
+    last_tic = gametic;
+
+    for (int i = 0; i < frames; i++)
+    {
+        capture_slot_t *slot = TakeFreeSlot();
+
+        for (int y = 0; y < height; y++)
+        {
+            memcpy(slot->pixels + y * width, pixels + y * pitch, width);
+        }
+
+        memcpy(slot->palette, palette, sizeof(slot->palette));
+
+        slot->has_audio =
+            capture_audio && I_OAL_RenderLoopback(slot->audio, SAMPLES_PER_TIC);
+
+        SDL_SemPost(filled_slots);
+    }
+}
@@ -0,0 +1,41 @@
+//
+//  Copyright(C) 2024 Alaux
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Capture of frames and sound to video files
+//
+
+#ifndef __I_CAPTURE__
+#define __I_CAPTURE__
+
+#include <stdint.h>
+
+#include "doomtype.h"
+
+// Sample rate of the captured sound, which is rendered in lockstep with
+// the captured frames
+#define CAPTURE_SAMPLE_RATE 44100
+
+void I_InitCapture(void);
+
+boolean I_CaptureActive(void);
+
+// Whether sound should be rendered for capture instead of played
+boolean I_CaptureAudio(void);
+
+// Called with every finished frame, before anything is drawn over it. One
+// frame is captured per game tic, repeating frames when tics are skipped.
+void I_CaptureFrame(const byte *pixels, int pitch, int width, int height,
+                    const uint32_t *palette);
+
+#endif
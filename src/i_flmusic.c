@@ -36,13 +36,13 @@ typedef fluid_long_long_t fluid_int_t;
 #include "d_main.h"
 #include "doomtype.h"
 #include "i_glob.h"
+#include "i_muscache.h"
 #include "i_printf.h"
 #include "i_sound.h"
 #include "m_array.h"
 #include "m_io.h"
 #include "m_misc.h"
 #include "memio.h"
-#include "mus2mid.h"
 #include "w_wad.h"
 #include "z_zone.h"
 
@@ -377,22 +377,15 @@ static boolean I_FL_OpenStream(void *data, ALsizei size, ALenum *format,
     else
     {
         // Assume a MUS file and try to convert
-        MEMFILE *instream;
-        MEMFILE *outstream;
-        void *outbuf;
+        const byte *outbuf;
         size_t outbuf_len;
 
-        instream = mem_fopen_read(data, size);
-        outstream = mem_fopen_write();
-
-        if (mus2mid(instream, outstream) == 0)
+        // [Nugget] Use the session cache of converted songs
+        if (I_GetMusMidi(data, size, &outbuf, &outbuf_len))
         {
-            mem_get_buf(outstream, &outbuf, &outbuf_len);
             result = fluid_player_add_mem(player, outbuf, outbuf_len);
         }
 
-        mem_fclose(instream);
-        mem_fclose(outstream);
         music_format = "MUS (FluidSynth)";
     }
 
@@ -166,6 +166,7 @@ const sound_module_t sound_mbf_module =
     I_MBF_ReinitSound,
     I_OAL_AllowReinitSound,
     I_OAL_CacheSound,
+    I_OAL_PrecacheSounds,
     I_MBF_AdjustSoundParams,
     I_MBF_UpdateSoundParams,
     NULL,
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 
 #include "doomtype.h"
+#include "i_muscache.h"
 #include "i_printf.h"
 #include "i_sound.h"
 #include "i_timer.h"
@@ -30,11 +31,11 @@
 #include "midiout.h"
 #include "midifallback.h"
 #include "midifile.h"
-#include "mus2mid.h"
 
 static SDL_Thread *player_thread_handle;
 static SDL_mutex *music_lock;
 static SDL_atomic_t player_thread_running;
+static SDL_cond *player_wakeup; // [Nugget]
 
 static boolean music_initialized;
 
@@ -1137,26 +1138,19 @@ static boolean RegisterSong(void)
     else
     {
         // Assume a MUS file and try to convert
-        MEMFILE *instream;
-        MEMFILE *outstream;
-        void *outbuf;
+        const byte *outbuf;
         size_t outbuf_len;
 
-        instream = mem_fopen_read(song.lump_data, song.lump_length);
-        outstream = mem_fopen_write();
-
-        if (mus2mid(instream, outstream) == 0)
+        // [Nugget] Use the session cache of converted songs
+        if (I_GetMusMidi(song.lump_data, song.lump_length, &outbuf,
+                         &outbuf_len))
         {
-            mem_get_buf(outstream, &outbuf, &outbuf_len);
-            song.file = MIDI_LoadFile(outbuf, outbuf_len);
+            song.file = MIDI_LoadFile((void *)outbuf, outbuf_len);
         }
         else
         {
             song.file = NULL;
         }
-
-        mem_fclose(instream);
-        mem_fclose(outstream);
     }
 
     if (song.file == NULL)
@@ -1186,19 +1180,53 @@ static boolean RegisterSong(void)
     return true;
 }
 
+// [Nugget] /-----------------------------------------------------------------
+
+// Longest wait while paused or stopped; state changes wake the thread anyway
+#define IDLE_WAIT_MS 500
+
+// Waits on `player_wakeup` for the whole milliseconds of `us`, leaving the
+// remainder to be slept precisely. Returns the time left to sleep, which is
+// done with `music_lock` released. Must be called with `music_lock` held.
+static int64_t WaitForPlayer(int64_t us)
+{
+    const Uint32 ms = us > 0 ? (us - 1) / 1000 : IDLE_WAIT_MS;
+
+    // Check under the lock, so that a stop request can't be missed
+    if (!SDL_AtomicGet(&player_thread_running))
+    {
+        return 0;
+    }
+
+    if (ms)
+    {
+        SDL_CondWaitTimeout(player_wakeup, music_lock, ms);
+        return 0;
+    }
+
+    return us;
+}
+
+static void WakePlayer(void)
+{
+    SDL_CondSignal(player_wakeup);
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 static int PlayerThread(void *unused)
 {
     SDL_SetThreadPriority(SDL_THREAD_PRIORITY_TIME_CRITICAL);
 
     midi_position_t position = {0};
-    boolean sleep = false;
+    int64_t sleep = 0; // [Nugget]
 
     while (SDL_AtomicGet(&player_thread_running))
     {
         if (sleep)
         {
-            I_SleepUS(500);
-            sleep = false;
+            I_SleepUS(sleep); // [Nugget]
+            sleep = 0;
         }
 
         // The MIDI thread must have exclusive access to shared resources until
@@ -1236,7 +1264,8 @@ static int PlayerThread(void *unused)
                         TicksToUS(song.elapsed_time) - CurrentTime();
                     if (remaining_time > 1000)
                     {
-                        sleep = true;
+                        // [Nugget] Sleep until the event is due
+                        sleep = WaitForPlayer(remaining_time - 1000);
                         break;
                     }
                     ProcessEvent(position.event, position.track);
@@ -1246,7 +1275,7 @@ static int PlayerThread(void *unused)
 
             case STATE_STOPPED:
             case STATE_PAUSED:
-                sleep = true;
+                WaitForPlayer(0); // [Nugget]
                 break;
         }
 
@@ -1352,8 +1381,15 @@ static void I_MID_StopSong(void *handle)
     }
 
     SDL_AtomicSet(&player_thread_running, 0);
+
+    // [Nugget]
+    SDL_LockMutex(music_lock);
+    WakePlayer();
+    SDL_UnlockMutex(music_lock);
+
     SDL_WaitThread(player_thread_handle, NULL);
     SDL_DestroyMutex(music_lock);
+    SDL_DestroyCond(player_wakeup); // [Nugget]
 
     // Send notes/sound off to prevent hanging notes.
     SendNotesSoundOff();
@@ -1370,6 +1406,7 @@ static void I_MID_PlaySong(void *handle, boolean looping)
     song.looping = looping;
     midi_state = STATE_STARTUP;
     music_lock = SDL_CreateMutex();
+    player_wakeup = SDL_CreateCond(); // [Nugget]
     player_thread_handle = SDL_CreateThread(PlayerThread, NULL, NULL);
 }
 
@@ -1383,6 +1420,7 @@ static void I_MID_PauseSong(void *handle)
     SDL_LockMutex(music_lock);
     old_state = midi_state;
     midi_state = STATE_PAUSING;
+    WakePlayer(); // [Nugget]
     SDL_UnlockMutex(music_lock);
 }
 
@@ -1398,6 +1436,7 @@ static void I_MID_ResumeSong(void *handle)
     {
         RestartTimer(0);
         midi_state = old_state;
+        WakePlayer(); // [Nugget]
     }
     SDL_UnlockMutex(music_lock);
 }
@@ -0,0 +1,209 @@
+//
+//  Copyright(C) 2024 Alaux
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Session cache of MUS lumps converted to MIDI
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "i_muscache.h"
+#include "i_printf.h"
+#include "i_sound.h"
+#include "i_thread.h"
+#include "m_array.h"
+#include "m_misc.h"
+#include "memio.h"
+#include "mus2mid.h"
+
+typedef struct
+{
+    // Identifies the MUS data, since lumps may be cached at different
+    // addresses over the session
+    uint64_t hash;
+    int mus_len;
+
+    // Copy of the MUS data while it's being converted in the background
+    byte *mus;
+
+    byte *mid;
+    size_t mid_len;
+
+    // Set by the thread pool once a background conversion has finished
+    boolean done;
+
+    // The conversion was needed before it finished and done over again in
+    // another entry, so this one is freed once its job is done
+    boolean superseded;
+} mus_entry_t;
+
+// Entries are allocated individually, so that background conversions can
+// write into them while the array grows
+static mus_entry_t **entries;
+static SDL_mutex *cache_lock;
+
+static void FreeEntry(int i)
+{
+    const int last = array_size(entries) - 1;
+
+    free(entries[i]->mid);
+    free(entries[i]);
+
+    entries[i] = entries[last];
+    array_ptr(entries)->size--;
+}
+
+// Must be called with the lock held. An entry that has been converted
+// already is preferred over one still being converted in the background.
+static mus_entry_t *FindEntry(uint64_t hash, int mus_len)
+{
+    mus_entry_t *pending = NULL;
+
+    for (int i = 0; i < array_size(entries); i++)
+    {
+        if (entries[i]->superseded)
+        {
+            if (I_JobDone(&entries[i]->done))
+            {
+                FreeEntry(i--);
+            }
+        }
+        else if (entries[i]->hash == hash && entries[i]->mus_len == mus_len)
+        {
+            if (I_JobDone(&entries[i]->done))
+            {
+                return entries[i];
+            }
+
+            pending = entries[i];
+        }
+    }
+
+    return pending;
+}
+
+static mus_entry_t *NewEntry(uint64_t hash, int mus_len)
+{
+    mus_entry_t *entry = calloc(1, sizeof(*entry));
+
+    entry->hash = hash;
+    entry->mus_len = mus_len;
+    array_push(entries, entry);
+
+    return entry;
+}
+
+static void ConvertEntry(mus_entry_t *entry, const byte *mus)
+{
+    MEMFILE *instream = mem_fopen_read((void *)mus, entry->mus_len);
+    MEMFILE *outstream = mem_fopen_write();
+
+    if (mus2mid(instream, outstream) == 0)
+    {
+        void *outbuf;
+
+        mem_get_buf(outstream, &outbuf, &entry->mid_len);
+
+        // The buffer belongs to the stream, keep a copy
+        entry->mid = malloc(entry->mid_len);
+        memcpy(entry->mid, outbuf, entry->mid_len);
+    }
+
+    mem_fclose(instream);
+    mem_fclose(outstream);
+}
+
+static void ConvertJob(void *data)
+{
+    mus_entry_t *entry = data;
+
+    ConvertEntry(entry, entry->mus);
+
+    free(entry->mus);
+    entry->mus = NULL;
+}
+
+void I_InitMusCache(void)
+{
+    if (!cache_lock)
+    {
+        cache_lock = SDL_CreateMutex();
+    }
+}
+
+boolean I_GetMusMidi(const byte *mus, int mus_len, const byte **mid,
+                     size_t *mid_len)
+{
+    const uint64_t hash = M_HashData(mus, mus_len);
+    mus_entry_t *entry;
+
+    SDL_LockMutex(cache_lock);
+
+    entry = FindEntry(hash, mus_len);
+
+    // This may be called from the MIDI player thread, which mustn't wait on
+    // the thread pool, so a conversion still running in the background is
+    // done over again here
+    if (!entry || !I_JobDone(&entry->done))
+    {
+        if (entry)
+        {
+            entry->superseded = true;
+        }
+
+        // Converting is cheap enough to be done with the lock held
+        entry = NewEntry(hash, mus_len);
+        ConvertEntry(entry, mus);
+        entry->done = true;
+    }
+
+    SDL_UnlockMutex(cache_lock);
+
+    *mid = entry->mid;
+    *mid_len = entry->mid_len;
+
+    return (entry->mid != NULL);
+}
+
+void I_PreconvertMus(const byte *mus, int mus_len)
+{
+    uint64_t hash;
+    mus_entry_t *entry = NULL;
+
+    if (!IsMus((byte *)mus, mus_len))
+    {
+        return;
+    }
+
+    hash = M_HashData(mus, mus_len);
+
+    SDL_LockMutex(cache_lock);
+
+    if (!FindEntry(hash, mus_len))
+    {
+        entry = NewEntry(hash, mus_len);
+        entry->mus = malloc(mus_len);
+        memcpy(entry->mus, mus, mus_len);
+    }
+
+    SDL_UnlockMutex(cache_lock);
+
+    if (entry)
+    {
+        I_Printf(VB_DEBUG, "I_PreconvertMus: Converting %d bytes", mus_len);
+        I_QueueJob(ConvertJob, entry, &entry->done);
+    }
+}
@@ -0,0 +1,38 @@
+//
+//  Copyright(C) 2024 Alaux
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Session cache of MUS lumps converted to MIDI
+//
+
+#ifndef __I_MUSCACHE__
+#define __I_MUSCACHE__
+
+#include <stddef.h>
+
+#include "doomtype.h"
+
+void I_InitMusCache(void);
+
+// Gets the MIDI conversion of the given MUS data, converting it now unless
+// it's already cached. Never waits for a background conversion. The returned
+// buffer belongs to the cache and stays valid for the whole session.
+// Safe to call from any thread.
+boolean I_GetMusMidi(const byte *mus, int mus_len, const byte **mid,
+                     size_t *mid_len);
+
+// Queues a background conversion of the given MUS data, unless it's already
+// cached. Does nothing for data that isn't MUS.
+void I_PreconvertMus(const byte *mus, int mus_len);
+
+#endif
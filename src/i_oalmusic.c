@@ -20,6 +20,7 @@
 #include "alext.h"
 #include "ebur128.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 
 #include "doomtype.h"
@@ -27,8 +28,15 @@
 #include "i_oalstream.h"
 #include "i_printf.h"
 #include "i_sound.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
 #include "m_array.h"
 #include "m_config.h"
+#include "m_io.h"
+#include "m_misc.h"
+#include "w_wad.h"
+#include "z_zone.h"
 
 // Define the number of buffers and buffer size (in milliseconds) to use. 4
 // buffers with 4096 samples each gives a nice per-chunk size, and lets the
@@ -65,6 +73,7 @@ static stream_module_t *midi_modules[] =
 };
 
 static stream_module_t *active_module;
+static stream_module_t *midi_stream_module; // [Nugget] Selected MIDI player
 
 typedef struct
 {
@@ -91,6 +100,137 @@ static stream_player_t player;
 static SDL_Thread *player_thread_handle;
 static SDL_atomic_t player_thread_running;
 
+// [Nugget] /-----------------------------------------------------------------
+
+// The player thread sleeps until the oldest queued buffer is due to drain,
+// or until it's woken up by a stop/resume request or a buffer-completed event
+
+// Longest sleep while the source is paused; resuming wakes the thread anyway
+#define PAUSED_WAIT_MS 500
+
+static SDL_mutex *player_lock;
+static SDL_cond *player_wakeup;
+static boolean player_woken;
+
+static boolean buffer_events;
+
+static void WakePlayer(void)
+{
+    if (!player_lock)
+    {
+        return;
+    }
+
+    SDL_LockMutex(player_lock);
+    player_woken = true;
+    SDL_CondSignal(player_wakeup);
+    SDL_UnlockMutex(player_lock);
+}
+
+#if defined(AL_SOFT_events)
+static LPALEVENTCONTROLSOFT alEventControlSOFT;
+static LPALEVENTCALLBACKSOFT alEventCallbackSOFT;
+
+// Called from an OpenAL thread, so it must not make any AL calls
+static void AL_APIENTRY BufferEvent(ALenum type, ALuint object, ALuint param,
+                                    ALsizei length, const ALchar *message,
+                                    void *userparam)
+{
+    if (type == AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT && object == player.source)
+    {
+        WakePlayer();
+    }
+}
+
+static void InitBufferEvents(void)
+{
+    const ALenum types[] = {AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT};
+
+    if (!alIsExtensionPresent("AL_SOFT_events"))
+    {
+        return;
+    }
+
+    ALFUNC(LPALEVENTCONTROLSOFT, alEventControlSOFT);
+    ALFUNC(LPALEVENTCALLBACKSOFT, alEventCallbackSOFT);
+
+    if (!alEventControlSOFT || !alEventCallbackSOFT)
+    {
+        return;
+    }
+
+    alEventCallbackSOFT(BufferEvent, NULL);
+    alEventControlSOFT(arrlen(types), types, AL_TRUE);
+
+    buffer_events = (alGetError() == AL_NO_ERROR);
+}
+
+static void ShutdownBufferEvents(void)
+{
+    if (buffer_events)
+    {
+        const ALenum types[] = {AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT};
+
+        alEventControlSOFT(arrlen(types), types, AL_FALSE);
+        alEventCallbackSOFT(NULL, NULL);
+        buffer_events = false;
+    }
+}
+#else
+#define InitBufferEvents()
+#define ShutdownBufferEvents()
+#endif
+
+// Milliseconds until the buffer at the front of the queue has been played
+static Uint32 NextBufferDeadline(void)
+{
+    ALint state, offset;
+
+    alGetSourcei(player.source, AL_SOURCE_STATE, &state);
+    alGetSourcei(player.source, AL_SAMPLE_OFFSET, &offset);
+
+    if (alGetError() != AL_NO_ERROR || state == AL_PAUSED)
+    {
+        return PAUSED_WAIT_MS;
+    }
+
+    if (state != AL_PLAYING)
+    {
+        // Underrun or end of playback, handle it right away
+        return 0;
+    }
+
+    // Every queued buffer is full except for the very last one of a song,
+    // so the offset into the front buffer is taken modulo the buffer size
+    const int remaining = BUFFER_SAMPLES - (offset % BUFFER_SAMPLES);
+
+    // Round up so that the buffer is already processed when we wake up
+    Uint32 ms = (remaining * 1000 + player.freq - 1) / player.freq + 1;
+
+    // With buffer-completed events, the deadline is only a fallback
+    if (buffer_events)
+    {
+        ms *= 2;
+    }
+
+    return ms;
+}
+
+static void WaitForPlayer(Uint32 timeout)
+{
+    SDL_LockMutex(player_lock);
+
+    if (!player_woken && timeout && SDL_AtomicGet(&player_thread_running))
+    {
+        SDL_CondWaitTimeout(player_wakeup, player_lock, timeout);
+    }
+
+    player_woken = false;
+    SDL_UnlockMutex(player_lock);
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 static boolean music_initialized;
 
 static ebur128_state *ebur_state;
@@ -347,9 +487,10 @@ static int PlayerThread(void *unused)
         if (!UpdatePlayer())
         {
             SDL_AtomicSet(&player_thread_running, 0);
+            break;
         }
 
-        SDL_Delay(1);
+        WaitForPlayer(NextBufferDeadline()); // [Nugget]
     }
 
     return 0;
@@ -385,6 +526,11 @@ boolean I_OAL_InitStream(void)
         alSourcei(player.source, AL_SOURCE_SPATIALIZE_SOFT, AL_FALSE);
     }
 
+    // [Nugget]
+    player_lock = SDL_CreateMutex();
+    player_wakeup = SDL_CreateCond();
+    InitBufferEvents();
+
     for (int i = 0; i < arrlen(stream_modules); ++i)
     {
         stream_modules[i]->I_InitStream(0);
@@ -392,6 +538,8 @@ boolean I_OAL_InitStream(void)
 
     music_initialized = true;
 
+    I_OPL_Benchmark(); // [Nugget]
+
     return true;
 }
 
@@ -407,6 +555,13 @@ void I_OAL_ShutdownStream(void)
         stream_modules[i]->I_ShutdownStream();
     }
 
+    // [Nugget]
+    ShutdownBufferEvents();
+    SDL_DestroyCond(player_wakeup);
+    SDL_DestroyMutex(player_lock);
+    player_wakeup = NULL;
+    player_lock = NULL;
+
     alDeleteSources(1, &player.source);
     alDeleteBuffers(NUM_BUFFERS, player.buffers);
     if (alGetError() != AL_NO_ERROR)
@@ -430,7 +585,14 @@ static boolean I_OAL_InitMusic(int device)
         if (device >= count_devices
             && device < count_devices + array_size(strings))
         {
-            return midi_modules[i]->I_InitStream(device - count_devices);
+            // [Nugget] Remember the selected player
+            if (midi_modules[i]->I_InitStream(device - count_devices))
+            {
+                midi_stream_module = midi_modules[i];
+                return true;
+            }
+
+            return false;
         }
 
         count_devices += array_size(strings);
@@ -485,6 +647,7 @@ static void I_OAL_ResumeSong(void *handle)
     }
 
     alSourcePlay(player.source);
+    WakePlayer(); // [Nugget]
 }
 
 static void I_OAL_PlaySong(void *handle, boolean looping)
@@ -517,6 +680,7 @@ static void I_OAL_StopSong(void *handle)
     alSourceStop(player.source);
 
     SDL_AtomicSet(&player_thread_running, 0);
+    WakePlayer(); // [Nugget]
     SDL_WaitThread(player_thread_handle, NULL);
 
     if (alGetError() != AL_NO_ERROR)
@@ -585,6 +749,201 @@ static void *I_OAL_RegisterSong(void *data, int len)
     return NULL;
 }
 
+// [Nugget] /-----------------------------------------------------------------
+
+// Offline render of a song through the same stream modules used in game
+
+static void WriteLE(FILE *file, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        fputc((value >> (i * 8)) & 0xff, file);
+    }
+}
+
+static boolean WriteWAV(const char *filename, const byte *data, int size)
+{
+    FILE *file = M_fopen(filename, "wb");
+
+    if (!file)
+    {
+        return false;
+    }
+
+    const boolean is_float = (player.format == AL_FORMAT_MONO_FLOAT32
+                              || player.format == AL_FORMAT_STEREO_FLOAT32);
+    const int bits = player.frame_size * 8 / player.channels;
+
+    fwrite("RIFF", 1, 4, file);
+    WriteLE(file, 36 + size, 4);
+    fwrite("WAVEfmt ", 1, 8, file);
+    WriteLE(file, 16, 4);
+    WriteLE(file, is_float ? 3 : 1, 2); // IEEE float or PCM
+    WriteLE(file, player.channels, 2);
+    WriteLE(file, player.freq, 4);
+    WriteLE(file, player.freq * player.frame_size, 4);
+    WriteLE(file, player.frame_size, 2);
+    WriteLE(file, bits, 2);
+    fwrite("data", 1, 4, file);
+    WriteLE(file, size, 4);
+
+    const boolean result = (fwrite(data, 1, size, file) == size);
+
+    fclose(file);
+
+    return result;
+}
+
+// Unlike `I_OAL_RegisterSong()`, only the selected MIDI player is tried
+static boolean OpenBenchmarkStream(void *data, int len)
+{
+    if (midi_stream_module
+        && midi_stream_module->I_OpenStream(data, len, &player.format,
+                                            &player.freq, &player.frame_size))
+    {
+        active_module = midi_stream_module;
+        return true;
+    }
+
+    for (int i = 0; i < arrlen(stream_modules); ++i)
+    {
+        if (stream_modules[i]->I_OpenStream(data, len, &player.format,
+                                            &player.freq, &player.frame_size))
+        {
+            active_module = stream_modules[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void I_OAL_BenchmarkMusic(void)
+{
+    //!
+    // @arg <lump> [seconds]
+    // @category obscure
+    //
+    // Render the given music lump (or file) offline with the currently
+    // selected MIDI player or the matching streaming backend, for the given
+    // number of seconds (60 by default). Print the real-time factor and the
+    // peak time taken to fill a buffer, write the output to <lump>.wav, and
+    // quit.
+    //
+
+    const int p = M_CheckParmWithArgs("-benchmusic", 1);
+    const char *name;
+    byte *data, *pcm;
+    int size, seconds = 60;
+    uint64_t start, time, peak = 0;
+    int total_frames, frames = 0;
+    size_t pcm_size;
+
+    if (!p)
+    {
+        return;
+    }
+
+    if (!music_initialized)
+    {
+        I_Error("I_OAL_BenchmarkMusic: OpenAL streaming is unavailable.");
+    }
+
+    name = myargv[p + 1];
+
+    if (p + 2 < myargc && myargv[p + 2][0] != '-')
+    {
+        seconds = BETWEEN(1, 3600, M_ParmArg2ToInt(p));
+    }
+
+    if (M_FileExists(name))
+    {
+        size = M_ReadFile(name, &data);
+    }
+    else
+    {
+        const int lumpnum = W_CheckNumForName(name);
+
+        if (lumpnum < 0)
+        {
+            I_Error("I_OAL_BenchmarkMusic: %s not found.", name);
+        }
+
+        data = W_CacheLumpNum(lumpnum, PU_STATIC);
+        size = W_LumpLength(lumpnum);
+    }
+
+    if (!OpenBenchmarkStream(data, size))
+    {
+        I_Error("I_OAL_BenchmarkMusic: %s could not be opened by the "
+                "selected MIDI player or any streaming backend.", name);
+    }
+
+    active_module->I_PlayStream(true);
+
+    total_frames = seconds * player.freq;
+    pcm_size = (size_t)total_frames * player.frame_size;
+    pcm = malloc(pcm_size);
+
+    if (!pcm)
+    {
+        I_Error("I_OAL_BenchmarkMusic: Failed to allocate %d seconds of "
+                "audio.", seconds);
+    }
+    start = I_GetTimeUS();
+
+    while (frames < total_frames)
+    {
+        const uint64_t buffer_start = I_GetTimeUS();
+        const int result = active_module->I_FillStream(
+            pcm + frames * player.frame_size,
+            MIN(BUFFER_SAMPLES, total_frames - frames));
+
+        peak = MAX(peak, I_GetTimeUS() - buffer_start);
+
+        if (result < 1)
+        {
+            break;
+        }
+
+        frames += result;
+    }
+
+    time = I_GetTimeUS() - start;
+
+    const double rendered = (double)frames / player.freq;
+
+    I_Printf(VB_ALWAYS,
+             "I_OAL_BenchmarkMusic: %s (%s): %.1f s of audio in %.3f s "
+             "(%.1fx real time), peak %.2f ms per %d-frame buffer "
+             "(%.2f ms of audio)",
+             name, active_module->I_MusicFormat(), rendered,
+             time / 1000000.0, rendered * 1000000.0 / MAX(time, 1),
+             peak / 1000.0, BUFFER_SAMPLES,
+             BUFFER_SAMPLES * 1000.0 / player.freq);
+
+    char *filename = M_StringJoin(M_BaseName(name), ".wav");
+
+    if (WriteWAV(filename, pcm, frames * player.frame_size))
+    {
+        I_Printf(VB_ALWAYS, "I_OAL_BenchmarkMusic: Wrote %s", filename);
+    }
+    else
+    {
+        I_Printf(VB_ERROR, "I_OAL_BenchmarkMusic: Failed to write %s",
+                 filename);
+    }
+
+    free(filename);
+    free(pcm);
+    I_OAL_UnRegisterSong(NULL);
+    Z_Free(data);
+
+    I_SafeExit(0);
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 static const char **I_OAL_DeviceList(void)
 {
     static const char **devices = NULL;
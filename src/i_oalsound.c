@@ -25,16 +25,21 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "i_capture.h"
 #include "i_oalcommon.h"
 #include "i_oalequalizer.h"
 #include "i_oalsound.h"
 #include "i_printf.h"
 #include "i_rumble.h"
+#include "i_sfxcache.h"
 #include "i_sndfile.h"
 #include "i_sound.h"
+#include "i_system.h"
+#include "i_thread.h"
 #include "m_array.h"
 #include "m_config.h"
 #include "m_fixed.h"
+#include "m_misc.h"
 #include "sounds.h"
 #include "w_wad.h"
 #include "z_zone.h"
@@ -68,6 +73,65 @@ oal_system_t *oal;
 static LPALDEFERUPDATESSOFT alDeferUpdatesSOFT;
 static LPALPROCESSUPDATESSOFT alProcessUpdatesSOFT;
 
+// [Nugget] Last values pushed to each source. Most sources don't move or
+// change volume between frames, so redundant AL calls are skipped.
+typedef struct
+{
+    ALfloat gain;
+    ALfloat position[3];
+    ALfloat velocity[3];
+    boolean gain_valid;
+    boolean position_valid;
+} source_cache_t;
+
+static source_cache_t source_cache[MAX_CHANNELS];
+
+// [Nugget] Sound is rendered for capture
+static boolean loopback;
+static LPALCRENDERSAMPLESSOFT alcRenderSamplesSOFT;
+
+// [Nugget] Sound lumps are decoded on worker threads; only the buffer
+// upload, which needs the OpenAL context, and any error reporting happen
+// on the main thread
+
+typedef struct
+{
+    int lumpnum;
+    byte *lumpdata; // Own copy, so that no zone memory is touched off-thread
+    byte *wavdata;
+    byte *sampledata;
+    ALsizei size, freq;
+    ALenum format;
+    boolean result;
+    boolean decode_failed;
+    char error[128];
+    boolean done;
+} sfxdecode_t;
+
+// Decodes that have been queued but not uploaded yet, indexed like S_sfx
+static sfxdecode_t **pending_decodes;
+static int num_pending_decodes;
+
+static void FreeDecode(sfxdecode_t *job)
+{
+    free(job->lumpdata);
+    free(job->wavdata);
+    free(job);
+}
+
+static void FreePendingDecodes(void)
+{
+    for (int i = 0; i < num_pending_decodes; i++)
+    {
+        if (pending_decodes[i])
+        {
+            I_WaitForJob(&pending_decodes[i]->done);
+            FreeDecode(pending_decodes[i]);
+            pending_decodes[i] = NULL;
+        }
+    }
+}
+
 void I_OAL_DeferUpdates(void)
 {
     if (!oal)
@@ -134,6 +198,9 @@ void I_OAL_ShutdownModule(void)
         alSourcei(oal->sources[i], AL_BUFFER, 0);
     }
 
+    FreePendingDecodes(); // [Nugget]
+    I_FlushSfxCache(); // [Nugget]
+
     for (i = 0; i < num_sfx; ++i)
     {
         if (S_sfx[i].cached)
@@ -252,6 +319,7 @@ void I_OAL_ResetSource2D(int channel)
 
     alSource3f(oal->sources[channel], AL_POSITION, 0.0f, 0.0f, 0.0f);
     alSource3f(oal->sources[channel], AL_VELOCITY, 0.0f, 0.0f, 0.0f);
+    source_cache[channel].position_valid = false; // [Nugget]
 
     alSourcei(oal->sources[channel], AL_ROLLOFF_FACTOR, 0);
     alSourcei(oal->sources[channel], AL_SOURCE_RELATIVE, AL_TRUE);
@@ -288,6 +356,23 @@ void I_OAL_UpdateSourceParams(int channel, const ALfloat *position,
         return;
     }
 
+    // [Nugget] /-----------------------------------------------------------
+
+    source_cache_t *const cache = &source_cache[channel];
+
+    if (cache->position_valid
+        && !memcmp(cache->position, position, sizeof(cache->position))
+        && !memcmp(cache->velocity, velocity, sizeof(cache->velocity)))
+    {
+        return;
+    }
+
+    memcpy(cache->position, position, sizeof(cache->position));
+    memcpy(cache->velocity, velocity, sizeof(cache->velocity));
+    cache->position_valid = true;
+
+    // [Nugget] -----------------------------------------------------------/
+
     alSourcefv(oal->sources[channel], AL_POSITION, position);
     alSourcefv(oal->sources[channel], AL_VELOCITY, velocity);
 }
@@ -362,6 +447,9 @@ static void ResetParams(void)
     S_CLIPPING_DIST = (1200 << FRACBITS) * (STRICTMODE(s_clipping_dist_x2) + 1); // Double sound-clipping distance
     S_ATTENUATOR = (S_CLIPPING_DIST - S_CLOSE_DIST) >> FRACBITS;
 
+    // [Nugget] Sources may have been recreated
+    memset(source_cache, 0, sizeof(source_cache));
+
     // Source parameters.
     for (i = 0; i < MAX_CHANNELS; i++)
     {
@@ -441,10 +529,74 @@ static void GetAttribs(ALCint **attribs)
         array_push(*attribs, snd_limiter ? ALC_TRUE : ALC_FALSE);
     }
 
+    // [Nugget] Loopback devices need the format to be rendered
+    if (loopback)
+    {
+        array_push(*attribs, ALC_FORMAT_CHANNELS_SOFT);
+        array_push(*attribs, ALC_STEREO_SOFT);
+        array_push(*attribs, ALC_FORMAT_TYPE_SOFT);
+        array_push(*attribs, ALC_SHORT_SOFT);
+        array_push(*attribs, ALC_FREQUENCY);
+        array_push(*attribs, CAPTURE_SAMPLE_RATE);
+    }
+
     // Attribute list must be zero terminated.
     array_push(*attribs, 0);
 }
 
+// [Nugget] /-----------------------------------------------------------------
+
+// When capturing, sound is mixed into a loopback device in lockstep with
+// the captured frames, instead of being played
+
+static ALCdevice *OpenDevice(void)
+{
+    LPALCLOOPBACKOPENDEVICESOFT alcLoopbackOpenDeviceSOFT;
+    ALCdevice *device;
+
+    loopback = false;
+
+    if (!I_CaptureAudio())
+    {
+        return alcOpenDevice(NULL);
+    }
+
+    if (alcIsExtensionPresent(NULL, "ALC_SOFT_loopback") == ALC_TRUE)
+    {
+        alcLoopbackOpenDeviceSOFT = FUNCTION_CAST(
+            LPALCLOOPBACKOPENDEVICESOFT,
+            alcGetProcAddress(NULL, "alcLoopbackOpenDeviceSOFT"));
+        alcRenderSamplesSOFT = FUNCTION_CAST(
+            LPALCRENDERSAMPLESSOFT,
+            alcGetProcAddress(NULL, "alcRenderSamplesSOFT"));
+
+        if (alcLoopbackOpenDeviceSOFT && alcRenderSamplesSOFT
+            && (device = alcLoopbackOpenDeviceSOFT(NULL)))
+        {
+            loopback = true;
+            return device;
+        }
+    }
+
+    I_Printf(VB_WARNING, "I_OAL_InitSound: Loopback rendering not supported, "
+                         "sound won't be captured.");
+
+    return alcOpenDevice(NULL);
+}
+
+boolean I_OAL_RenderLoopback(void *buffer, int frames)
+{
+    if (!oal || !loopback)
+    {
+        return false;
+    }
+
+    alcRenderSamplesSOFT(oal->device, buffer, frames);
+    return true;
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 void I_OAL_BindSoundVariables(void)
 {
     BIND_BOOL_GENERAL(snd_hrtf, false,
@@ -470,7 +622,7 @@ boolean I_OAL_InitSound(int snd_module)
     }
 
     oal = calloc(1, sizeof(*oal));
-    oal->device = alcOpenDevice(NULL);
+    oal->device = OpenDevice(); // [Nugget]
     if (!oal->device)
     {
         I_Printf(VB_ERROR, "I_OAL_InitSound: Failed to open device.");
@@ -596,83 +748,161 @@ static void FadeInOutMono8(byte *data, ALsizei size, ALsizei freq)
     }
 }
 
-boolean I_OAL_CacheSound(sfxinfo_t *sfx)
+// [Nugget] /-----------------------------------------------------------------
+
+// Sounds uploaded per batch at startup, bounding the lump data held at once
+#define PRECACHE_BATCH 256
+
+static void DecodeSound(void *data)
 {
-    int lumpnum;
-    byte *lumpdata = NULL, *wavdata = NULL;
+    sfxdecode_t *job = data;
+    byte *lumpdata = job->lumpdata;
+    const int lumplen = job->size;
 
-    if (!oal)
+    job->result = false;
+
+    // Check the header, and ensure this is a valid sound
+    if (lumplen > DMXHDRSIZE && lumpdata[0] == 0x03 && lumpdata[1] == 0x00)
     {
-        return false;
+        ALsizei size;
+
+        job->freq = (lumpdata[3] << 8) | lumpdata[2];
+        size = (lumpdata[7] << 24) | (lumpdata[6] << 16)
+               | (lumpdata[5] << 8) | lumpdata[4];
+
+        // Don't play sounds that think they're longer than they really are,
+        // only contain padding, or are shorter than the padding size.
+        if (size > lumplen - DMXHDRSIZE || size <= DMXPADSIZE * 2)
+        {
+            return;
+        }
+
+        // DMX skips the first and last 16 bytes of data. Custom sounds may
+        // be created with tools that aren't aware of this, which means part
+        // of the waveform is cut off. We compensate for this by fading in
+        // or out sounds that start or end at a non-zero amplitude to
+        // prevent clicking.
+        // Reference: https://www.doomworld.com/forum/post/949486
+        job->sampledata = lumpdata + DMXHDRSIZE + DMXPADSIZE;
+        job->size = size - DMXPADSIZE * 2;
+        FadeInOutMono8(job->sampledata, job->size, job->freq);
+
+        // All Doom sounds are 8-bit
+        job->format = AL_FORMAT_MONO8;
+    }
+    else
+    {
+        // Reuse the samples decoded by an earlier launch if possible
+        const uint64_t hash = M_HashData(lumpdata, lumplen);
+
+        if (!I_LoadCachedSfx(hash, lumplen, &job->format, &job->wavdata,
+                             &job->size, &job->freq))
+        {
+            if (I_SND_LoadFile(lumpdata, &job->format, &job->wavdata,
+                               &job->size, &job->freq, job->error,
+                               sizeof(job->error))
+                == false)
+            {
+                job->decode_failed = true;
+                return;
+            }
+
+            I_StoreCachedSfx(hash, lumplen, job->format, job->wavdata,
+                             job->size, job->freq);
+        }
+
+        job->sampledata = job->wavdata;
     }
 
-    lumpnum = I_GetSfxLumpNum(sfx);
+    job->result = true;
+}
+
+static sfxdecode_t *NewDecode(sfxinfo_t *sfx)
+{
+    const int lumpnum = I_GetSfxLumpNum(sfx);
+    sfxdecode_t *job;
 
     if (lumpnum < 0)
     {
-        return false;
+        return NULL;
     }
 
-    // haleyjd 06/03/06: rewrote again to make sound data properly freeable
-    while (sfx->cached == false)
+    job = calloc(1, sizeof(*job));
+    job->lumpnum = lumpnum;
+    job->size = W_LumpLength(lumpnum);
+    job->lumpdata = malloc(job->size);
+    W_ReadLump(lumpnum, job->lumpdata);
+
+    return job;
+}
+
+static sfxdecode_t *TakePendingDecode(const sfxinfo_t *sfx)
+{
+    const int index = sfx - S_sfx;
+    sfxdecode_t *job;
+
+    if (index < 0 || index >= num_pending_decodes || !pending_decodes[index])
     {
-        byte *sampledata;
-        int lumplen;
+        return NULL;
+    }
 
-        ALsizei size, freq;
-        ALenum format;
-        ALuint buffer;
+    job = pending_decodes[index];
+    pending_decodes[index] = NULL;
 
-        // haleyjd: this should always be called (if lump is already loaded,
-        // W_CacheLumpNum handles that for us).
-        lumpdata = (byte *)W_CacheLumpNum(lumpnum, PU_STATIC);
+    I_WaitForJob(&job->done);
 
-        lumplen = W_LumpLength(lumpnum);
+    return job;
+}
 
-        // Check the header, and ensure this is a valid sound
-        if (lumplen > DMXHDRSIZE && lumpdata[0] == 0x03 && lumpdata[1] == 0x00)
-        {
-            freq = (lumpdata[3] << 8) | lumpdata[2];
-            size = (lumpdata[7] << 24) | (lumpdata[6] << 16)
-                   | (lumpdata[5] << 8) | lumpdata[4];
+static void QueueDecode(sfxinfo_t *sfx)
+{
+    const int index = sfx - S_sfx;
+    sfxdecode_t *job;
 
-            // Don't play sounds that think they're longer than they really are,
-            // only contain padding, or are shorter than the padding size.
-            if (size > lumplen - DMXHDRSIZE || size <= DMXPADSIZE * 2)
-            {
-                break;
-            }
+    if (sfx->cached || (index < num_pending_decodes && pending_decodes[index]))
+    {
+        return;
+    }
 
-            sampledata = lumpdata + DMXHDRSIZE;
+    if (!(job = NewDecode(sfx)))
+    {
+        return;
+    }
 
-            // DMX skips the first and last 16 bytes of data. Custom sounds may
-            // be created with tools that aren't aware of this, which means part
-            // of the waveform is cut off. We compensate for this by fading in
-            // or out sounds that start or end at a non-zero amplitude to
-            // prevent clicking.
-            // Reference: https://www.doomworld.com/forum/post/949486
-            sampledata += DMXPADSIZE;
-            size -= DMXPADSIZE * 2;
-            FadeInOutMono8(sampledata, size, freq);
+    if (index >= num_pending_decodes)
+    {
+        pending_decodes = I_Realloc(pending_decodes,
+                                    num_sfx * sizeof(*pending_decodes));
+        memset(pending_decodes + num_pending_decodes, 0,
+               (num_sfx - num_pending_decodes) * sizeof(*pending_decodes));
+        num_pending_decodes = num_sfx;
+    }
 
-            // All Doom sounds are 8-bit
-            format = AL_FORMAT_MONO8;
+    pending_decodes[index] = job;
+    I_QueueJob(DecodeSound, job, &job->done);
+}
+
+static boolean UploadSound(sfxinfo_t *sfx, sfxdecode_t *job)
+{
+    ALuint buffer;
+
+    if (job->decode_failed)
+    {
+        if (job->error[0])
+        {
+            I_Printf(VB_WARNING, " I_OAL_CacheSound: %s: %s",
+                     lumpinfo[job->lumpnum].name, job->error);
         }
         else
         {
-            size = lumplen;
-
-            if (I_SND_LoadFile(lumpdata, &format, &wavdata, &size, &freq)
-                == false)
-            {
-                I_Printf(VB_WARNING, " I_OAL_CacheSound: %s",
-                         lumpinfo[lumpnum].name);
-                break;
-            }
-
-            sampledata = wavdata;
+            I_Printf(VB_WARNING, " I_OAL_CacheSound: %s",
+                     lumpinfo[job->lumpnum].name);
         }
+    }
 
+    // haleyjd 06/03/06: rewrote again to make sound data properly freeable
+    while (job->result && sfx->cached == false)
+    {
         alGetError();
         alGenBuffers(1, &buffer);
         if (alGetError() != AL_NO_ERROR)
@@ -680,7 +910,8 @@ boolean I_OAL_CacheSound(sfxinfo_t *sfx)
             I_Printf(VB_ERROR, "I_OAL_CacheSound: Error creating buffers.");
             break;
         }
-        alBufferData(buffer, format, sampledata, size, freq);
+        alBufferData(buffer, job->format, job->sampledata, job->size,
+                     job->freq);
         if (alGetError() != AL_NO_ERROR)
         {
             I_Printf(VB_ERROR, "I_OAL_CacheSound: Error buffering data.");
@@ -689,28 +920,89 @@ boolean I_OAL_CacheSound(sfxinfo_t *sfx)
 
         sfx->buffer = buffer;
         sfx->cached = true;
-        I_CacheRumble(sfx, format, sampledata, size, freq);
+        I_CacheRumble(sfx, job->format, job->sampledata, job->size,
+                      job->freq);
     }
 
     // don't need original lump data any more
-    if (lumpdata)
+    FreeDecode(job);
+
+    if (sfx->cached == false)
     {
-        Z_Free(lumpdata);
+        sfx->lumpnum = -2; // [FG] don't try again
+        return false;
     }
-    if (wavdata)
+
+    return true;
+}
+
+boolean I_OAL_CacheSound(sfxinfo_t *sfx)
+{
+    sfxdecode_t *job;
+
+    if (!oal)
     {
-        free(wavdata);
+        return false;
     }
 
-    if (sfx->cached == false)
+    if (I_GetSfxLumpNum(sfx) < 0)
     {
-        sfx->lumpnum = -2; // [FG] don't try again
         return false;
     }
 
-    return true;
+    if (sfx->cached)
+    {
+        return true;
+    }
+
+    // Use the background decode if one was queued, otherwise decode now
+    if (!(job = TakePendingDecode(sfx)))
+    {
+        job = NewDecode(sfx);
+        DecodeSound(job);
+    }
+
+    return UploadSound(sfx, job);
 }
 
+void I_OAL_PrecacheSounds(sfxinfo_t **sfx, int num, boolean wait)
+{
+    if (!oal)
+    {
+        return;
+    }
+
+    if (!wait)
+    {
+        // Leave the decoded data pending until the sounds are first played
+        for (int i = 0; i < num; i++)
+        {
+            QueueDecode(sfx[i]);
+        }
+
+        return;
+    }
+
+    for (int batch = 0; batch < num; batch += PRECACHE_BATCH)
+    {
+        const int end = MIN(num, batch + PRECACHE_BATCH);
+
+        for (int i = batch; i < end; i++)
+        {
+            QueueDecode(sfx[i]);
+        }
+
+        for (int i = batch; i < end; i++)
+        {
+            I_OAL_CacheSound(sfx[i]);
+        }
+    }
+
+    I_FlushSfxCache();
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 boolean I_OAL_StartSound(int channel, sfxinfo_t *sfx, float pitch)
 {
     if (!oal)
@@ -768,7 +1060,22 @@ void I_OAL_SetVolume(int channel, int volume)
         return;
     }
 
-    alSourcef(oal->sources[channel], AL_GAIN, VOL_TO_GAIN(volume));
+    // [Nugget] /-----------------------------------------------------------
+
+    source_cache_t *const cache = &source_cache[channel];
+    const ALfloat gain = VOL_TO_GAIN(volume);
+
+    if (cache->gain_valid && cache->gain == gain)
+    {
+        return;
+    }
+
+    cache->gain = gain;
+    cache->gain_valid = true;
+
+    // [Nugget] -----------------------------------------------------------/
+
+    alSourcef(oal->sources[channel], AL_GAIN, gain);
 }
 
 void I_OAL_SetPan(int channel, int separation)
@@ -780,6 +1087,10 @@ void I_OAL_SetPan(int channel, int separation)
         return;
     }
 
+    // [Nugget] The panning emulation moves the source, so forget
+    // whatever position the 3D module last pushed
+    source_cache[channel].position_valid = false;
+
     // Emulate 2D panning (https://github.com/kcat/openal-soft/issues/194).
     // This works by sliding the sound source along the x-axis while inverting
     // the circular shape of the sound field along the z-axis. The end result
@@ -58,6 +58,8 @@ boolean I_OAL_AllowReinitSound(void);
 
 boolean I_OAL_CacheSound(struct sfxinfo_s *sfx);
 
+void I_OAL_PrecacheSounds(struct sfxinfo_s **sfx, int num, boolean wait);
+
 boolean I_OAL_StartSound(int channel, struct sfxinfo_s *sfx, float pitch);
 
 void I_OAL_StopSound(int channel);
@@ -70,4 +72,8 @@ void I_OAL_SetPan(int channel, int separation);
 
 void I_OAL_BindSoundVariables(void);
 
+// Mixes the given number of stereo 16-bit frames, when sound is being
+// rendered for capture instead of played
+boolean I_OAL_RenderLoopback(void *buffer, int frames);
+
 #endif
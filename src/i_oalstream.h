@@ -42,6 +42,10 @@ extern stream_module_t stream_xmp_module;
 
 boolean I_OAL_InitStream(void);
 
+// [Nugget] Handle -benchopl and -benchmusic
+void I_OPL_Benchmark(void);
+void I_OAL_BenchmarkMusic(void);
+
 void I_OAL_ShutdownStream(void);
 
 #endif
@@ -22,16 +22,20 @@
 #include "opl.h"
 
 #include "doomtype.h"
+#include "i_muscache.h"
 #include "i_oalstream.h"
 #include "i_printf.h"
 #include "i_sound.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
 #include "m_array.h"
 #include "m_config.h"
 #include "m_io.h"
+#include "m_misc.h"
 #include "m_swap.h"
 #include "memio.h"
 #include "midifile.h"
-#include "mus2mid.h"
 #include "w_wad.h"
 #include "z_zone.h"
 
@@ -110,9 +114,10 @@ typedef struct
 
 typedef struct
 {
-    // Track iterator used to read new events.
+    // [Nugget] Index of the track in the MIDI file; the events themselves
+    // are read from the flattened event stream.
 
-    midi_track_iter_t *iter;
+    unsigned int num;
 } opl_track_data_t;
 
 typedef struct opl_voice_s opl_voice_t;
@@ -347,10 +352,12 @@ static unsigned int num_tracks = 0;
 static unsigned int running_tracks = 0;
 static boolean song_looping;
 
-// Tempo control variables
+// [Nugget] Events of all tracks, merged into a single time-sorted stream
+// with tempo changes already applied to their times
 
-static unsigned int ticks_per_beat;
-static unsigned int us_per_beat;
+static const midi_flat_event_t *song_events;
+static unsigned int num_song_events;
+static unsigned int next_song_event;
 
 // Mini-log of recently played percussion instruments:
 
@@ -1251,19 +1258,10 @@ static void PitchBendEvent(opl_track_data_t *track, midi_event_t *event)
     }
 }
 
-static void MetaSetTempo(unsigned int tempo)
-{
-    OPL_AdjustCallbacks((float)us_per_beat / tempo);
-    us_per_beat = tempo;
-}
-
 // Process a meta event.
 
 static void MetaEvent(opl_track_data_t *track, midi_event_t *event)
 {
-    byte *data = event->data.meta.data;
-    unsigned int data_len = event->data.meta.length;
-
     switch (event->data.meta.type)
     {
         // Things we can just ignore.
@@ -1279,11 +1277,10 @@ static void MetaEvent(opl_track_data_t *track, midi_event_t *event)
         case MIDI_META_SEQUENCER_SPECIFIC:
             break;
 
+        // [Nugget] Tempo changes are already applied to the times of the
+        // flattened event stream.
+
         case MIDI_META_SET_TEMPO:
-            if (data_len == 3)
-            {
-                MetaSetTempo((data[0] << 16) | (data[1] << 8) | data[2]);
-            }
             break;
 
         // End of track - actually handled when we run out of events in the
@@ -1341,8 +1338,8 @@ static void ProcessEvent(opl_track_data_t *track, midi_event_t *event)
     }
 }
 
-static void ScheduleTrack(opl_track_data_t *track);
 static void InitChannel(opl_channel_data_t *channel);
+static void StartSequencer(void);
 
 // Restart a song from the beginning.
 
@@ -1350,15 +1347,9 @@ static void RestartSong(void *unused)
 {
     unsigned int i;
 
-    running_tracks = num_tracks;
-
     start_music_volume = current_music_volume;
 
-    for (i = 0; i < num_tracks; ++i)
-    {
-        MIDI_RestartIterator(tracks[i].iter);
-        ScheduleTrack(&tracks[i]);
-    }
+    StartSequencer();
 
     for (i = 0; i < MIDI_CHANNELS_PER_TRACK; ++i)
     {
@@ -1366,64 +1357,67 @@ static void RestartSong(void *unused)
     }
 }
 
-// Callback function invoked when another event needs to be read from
-// a track.
+// [Nugget] Callback function invoked when the next events of the song are
+// due. Processes every event sharing the same time, then schedules itself
+// for the following one.
 
-static void TrackTimerCallback(void *arg)
+static void SequencerCallback(void *unused)
 {
-    opl_track_data_t *track = arg;
-    midi_event_t *event;
-
-    // Get the next event and process it.
-
-    if (!MIDI_GetNextEvent(track->iter, &event))
-    {
-        return;
-    }
-
-    ProcessEvent(track, event);
+    const uint64_t time_us = song_events[next_song_event].time_us;
 
-    // End of track?
-
-    if (event->event_type == MIDI_EVENT_META
-        && event->data.meta.type == MIDI_META_END_OF_TRACK)
+    while (next_song_event < num_song_events
+           && song_events[next_song_event].time_us == time_us)
     {
-        --running_tracks;
+        const midi_flat_event_t *flat = &song_events[next_song_event++];
+        midi_event_t *event = flat->event;
 
-        // When all tracks have finished, restart the song.
-        // Don't restart the song immediately, but wait for 5ms
-        // before triggering a restart.  Otherwise it is possible
-        // to construct an empty MIDI file that causes the game
-        // to lock up in an infinite loop. (5ms should be short
-        // enough not to be noticeable by the listener).
+        ProcessEvent(&tracks[flat->track], event);
 
-        if (running_tracks <= 0 && song_looping)
+        if (event->event_type == MIDI_EVENT_META
+            && event->data.meta.type == MIDI_META_END_OF_TRACK)
         {
-            OPL_SetCallback(5000, RestartSong, NULL);
+            --running_tracks;
         }
+    }
 
+    if (next_song_event < num_song_events)
+    {
+        OPL_SetCallback(song_events[next_song_event].time_us - time_us,
+                        SequencerCallback, NULL);
         return;
     }
 
-    // Reschedule the callback for the next event in the track.
-
-    ScheduleTrack(track);
-}
+    running_tracks = 0;
 
-static void ScheduleTrack(opl_track_data_t *track)
-{
-    unsigned int nticks;
-    uint64_t us;
+    // When all tracks have finished, restart the song.
+    // Don't restart the song immediately, but wait for 5ms
+    // before triggering a restart.  Otherwise it is possible
+    // to construct an empty MIDI file that causes the game
+    // to lock up in an infinite loop. (5ms should be short
+    // enough not to be noticeable by the listener).
 
-    // Get the number of microseconds until the next event.
+    if (song_looping)
+    {
+        OPL_SetCallback(5000, RestartSong, NULL);
+    }
+}
 
-    nticks = MIDI_GetDeltaTime(track->iter);
-    us = ((uint64_t)nticks * us_per_beat) / ticks_per_beat;
+// [Nugget] Schedule the first event of the song.
 
-    // Set a timer to be invoked when the next event is
-    // ready to play.
+static void StartSequencer(void)
+{
+    next_song_event = 0;
 
-    OPL_SetCallback(us, TrackTimerCallback, track);
+    if (num_song_events)
+    {
+        running_tracks = num_tracks;
+        OPL_SetCallback(song_events[0].time_us, SequencerCallback, NULL);
+    }
+    else
+    {
+        // An empty song has ended already
+        running_tracks = 0;
+    }
 }
 
 // Initialize a channel.
@@ -1443,20 +1437,6 @@ static void InitChannel(opl_channel_data_t *channel)
     channel->bend = 0;
 }
 
-// Start a MIDI track playing:
-
-static void StartTrack(midi_file_t *file, unsigned int track_num)
-{
-    opl_track_data_t *track;
-
-    track = &tracks[track_num];
-    track->iter = MIDI_IterateTrack(file, track_num);
-
-    // Schedule the first event.
-
-    ScheduleTrack(track);
-}
-
 static boolean I_OPL_InitStream(int device)
 {
     char *dmxoption;
@@ -1541,26 +1521,19 @@ static boolean I_OPL_OpenStream(void *data, ALsizei size, ALenum *format,
     else
     {
         // Assume a MUS file and try to convert
-        MEMFILE *instream;
-        MEMFILE *outstream;
-        void *outbuf;
+        const byte *outbuf;
         size_t outbuf_len;
 
-        instream = mem_fopen_read(data, size);
-        outstream = mem_fopen_write();
-
-        if (mus2mid(instream, outstream) == 0)
+        // [Nugget] Use the session cache of converted songs
+        if (I_GetMusMidi(data, size, &outbuf, &outbuf_len))
         {
-            mem_get_buf(outstream, &outbuf, &outbuf_len);
-            midifile = MIDI_LoadFile(outbuf, outbuf_len);
+            midifile = MIDI_LoadFile((void *)outbuf, outbuf_len);
         }
         else
         {
             midifile = NULL;
         }
 
-        mem_fclose(instream);
-        mem_fclose(outstream);
         music_format = "MUS (OPL)";
     }
 
@@ -1570,6 +1543,17 @@ static boolean I_OPL_OpenStream(void *data, ALsizei size, ALenum *format,
         return false;
     }
 
+    // [Nugget] Only this sequencer plays the flattened stream
+    song_events = MIDI_GetFlatEvents(midifile, &num_song_events);
+
+    if (song_events == NULL)
+    {
+        I_Printf(VB_ERROR, "I_OPL_RegisterSong: Failed to sort MID events.");
+        MIDI_FreeFile(midifile);
+        midifile = NULL;
+        return false;
+    }
+
     *format = AL_FORMAT_STEREO16;
     *freq = OPL_SAMPLE_RATE;
     *frame_size = 2 * sizeof(short);
@@ -1595,23 +1579,17 @@ static void I_OPL_PlayStream(boolean looping)
     tracks = malloc(MIDI_NumTracks(midifile) * sizeof(opl_track_data_t));
 
     num_tracks = MIDI_NumTracks(midifile);
-    running_tracks = num_tracks;
     song_looping = looping;
 
-    ticks_per_beat = MIDI_GetFileTimeDivision(midifile);
-
-    // Default is 120 bpm.
-    // TODO: this is wrong
-
-    us_per_beat = MIDI_DEFAULT_TEMPO;
-
-    start_music_volume = current_music_volume;
-
     for (i = 0; i < num_tracks; ++i)
     {
-        StartTrack(midifile, i);
+        tracks[i].num = i;
     }
 
+    start_music_volume = current_music_volume;
+
+    StartSequencer(); // [Nugget]
+
     for (i = 0; i < MIDI_CHANNELS_PER_TRACK; ++i)
     {
         InitChannel(&channels[i]);
@@ -1645,16 +1623,15 @@ static void I_OPL_CloseStream(void)
 
     // Free all track data.
 
-    for (i = 0; i < num_tracks; ++i)
-    {
-        MIDI_FreeIterator(tracks[i].iter);
-    }
-
     free(tracks);
 
     tracks = NULL;
     num_tracks = 0;
 
+    // [Nugget]
+    song_events = NULL;
+    num_song_events = 0;
+
     if (midifile)
     {
         MIDI_FreeFile(midifile);
@@ -1678,6 +1655,141 @@ static void I_OPL_ShutdownStream(void)
     }
 }
 
+// [Nugget] /-----------------------------------------------------------------
+
+// Offline render for benchmarking the synthesis. The chips are reset
+// before each run, so serial and parallel runs must produce the same PCM.
+
+static boolean BenchmarkRender(void *data, int size, boolean parallel,
+                               byte **pcm, int *pcm_size, uint64_t *time)
+{
+    // Stop after a second of the last notes' release, or 20 minutes
+    const int max_size = OPL_SAMPLE_RATE * 4 * 60 * 20;
+    const int block_frames = 4096;
+    int tail = OPL_SAMPLE_RATE;
+    ALenum format;
+    ALsizei freq, frame_size;
+    uint64_t start;
+
+    I_OPL_ShutdownStream();
+
+    if (!I_OPL_InitStream(0))
+    {
+        return false;
+    }
+
+    if (!I_OPL_OpenStream(data, size, &format, &freq, &frame_size))
+    {
+        I_OPL_ShutdownStream();
+        return false;
+    }
+
+    opl_parallel_chips = parallel;
+    I_OPL_PlayStream(false);
+
+    *pcm = NULL;
+    *pcm_size = 0;
+    start = I_GetTimeUS();
+
+    while (tail > 0 && *pcm_size < max_size)
+    {
+        *pcm = I_Realloc(*pcm, *pcm_size + block_frames * frame_size);
+        I_OPL_FillStream(*pcm + *pcm_size, block_frames);
+        *pcm_size += block_frames * frame_size;
+
+        if (running_tracks <= 0)
+        {
+            tail -= block_frames;
+        }
+    }
+
+    *time = I_GetTimeUS() - start;
+
+    I_OPL_CloseStream();
+    I_OPL_ShutdownStream();
+
+    opl_parallel_chips = 1;
+
+    return true;
+}
+
+void I_OPL_Benchmark(void)
+{
+    //!
+    // @arg <lump>
+    // @category obscure
+    //
+    // Render the given MIDI or MUS lump (or file) offline with the OPL
+    // emulator, once with serial and once with parallel chip synthesis,
+    // print the real-time factor of each, write the PCM output (signed
+    // 16-bit stereo at 49716 Hz) to <lump>.pcm, and quit.
+    //
+
+    const int p = M_CheckParmWithArgs("-benchopl", 1);
+    const char *name;
+    byte *data, *pcm[2];
+    int size, pcm_size[2];
+    uint64_t time[2];
+
+    if (!p)
+    {
+        return;
+    }
+
+    name = myargv[p + 1];
+
+    if (M_FileExists(name))
+    {
+        size = M_ReadFile(name, &data);
+    }
+    else
+    {
+        const int lumpnum = W_CheckNumForName(name);
+
+        if (lumpnum < 0)
+        {
+            I_Error("I_OPL_Benchmark: %s not found.", name);
+        }
+
+        data = W_CacheLumpNum(lumpnum, PU_STATIC);
+        size = W_LumpLength(lumpnum);
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (!BenchmarkRender(data, size, i, &pcm[i], &pcm_size[i], &time[i]))
+        {
+            I_Error("I_OPL_Benchmark: Failed to render %s.", name);
+        }
+
+        const double seconds = (double)pcm_size[i] / (OPL_SAMPLE_RATE * 4);
+
+        I_Printf(VB_ALWAYS,
+                 "I_OPL_Benchmark: %s, %d chip(s), %s: %.1f s of audio in "
+                 "%.3f s (%.1fx real time)",
+                 name, num_opl_chips, i ? "parallel" : "serial", seconds,
+                 time[i] / 1000000.0, seconds * 1000000.0 / MAX(time[i], 1));
+    }
+
+    if (pcm_size[0] != pcm_size[1] || memcmp(pcm[0], pcm[1], pcm_size[0]))
+    {
+        I_Printf(VB_WARNING, "I_OPL_Benchmark: Serial and parallel output differ!");
+    }
+
+    char *filename = M_StringJoin(M_BaseName(name), ".pcm");
+    M_WriteFile(filename, pcm[1], pcm_size[1]);
+    I_Printf(VB_ALWAYS, "I_OPL_Benchmark: Wrote %s", filename);
+
+    free(filename);
+    free(pcm[0]);
+    free(pcm[1]);
+    Z_Free(data);
+
+    I_SafeExit(0);
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 static const char **I_OPL_DeviceList(void)
 {
     static const char **devices = NULL;
@@ -0,0 +1,101 @@
+//
+//  Copyright(C) 2024 Alaux
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Expansion of paletted pixels to ARGB8888
+//
+
+#include "SDL.h"
+
+#include "i_palconv.h"
+#include "i_printf.h"
+
+// Only AVX2 has a gather instruction; with SSE2 or NEON, a palette lookup
+// is no faster than the scalar loop, which compilers already unroll
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define HAVE_AVX2_KERNEL
+  #define TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+  #define HAVE_AVX2_KERNEL
+  #define TARGET_AVX2
+#endif
+
+#if defined(HAVE_AVX2_KERNEL)
+  #include <immintrin.h>
+#endif
+
+typedef void (*expandrow_t)(const byte *src, uint32_t *dst, int width,
+                            const uint32_t *palette);
+
+static void ExpandRow_Scalar(const byte *src, uint32_t *dst, int width,
+                             const uint32_t *palette)
+{
+    int x = 0;
+
+    for (; x + 4 <= width; x += 4)
+    {
+        dst[x + 0] = palette[src[x + 0]];
+        dst[x + 1] = palette[src[x + 1]];
+        dst[x + 2] = palette[src[x + 2]];
+        dst[x + 3] = palette[src[x + 3]];
+    }
+
+    for (; x < width; x++)
+    {
+        dst[x] = palette[src[x]];
+    }
+}
+
+#if defined(HAVE_AVX2_KERNEL)
+TARGET_AVX2
+static void ExpandRow_AVX2(const byte *src, uint32_t *dst, int width,
+                           const uint32_t *palette)
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+    {
+        const __m256i index =
+            _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + x)));
+        const __m256i argb =
+            _mm256_i32gather_epi32((const int *)palette, index, 4);
+
+        _mm256_storeu_si256((__m256i *)(dst + x), argb);
+    }
+
+    ExpandRow_Scalar(src + x, dst + x, width - x, palette);
+}
+#endif
+
+static expandrow_t expand_row = ExpandRow_Scalar;
+
+void I_InitPaletteConversion(void)
+{
+#if defined(HAVE_AVX2_KERNEL)
+    if (SDL_HasAVX2())
+    {
+        expand_row = ExpandRow_AVX2;
+        I_Printf(VB_DEBUG, "I_InitPaletteConversion: Using AVX2");
+        return;
+    }
+#endif
+
+    expand_row = ExpandRow_Scalar;
+}
+
+void I_ExpandPaletteRow(const byte *src, uint32_t *dst, int width,
+                        const uint32_t *palette)
+{
+    expand_row(src, dst, width, palette);
+}
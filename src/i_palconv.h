@@ -0,0 +1,31 @@
+//
+//  Copyright(C) 2024 Alaux
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Expansion of paletted pixels to ARGB8888
+//
+
+#ifndef __I_PALCONV__
+#define __I_PALCONV__
+
+#include <stdint.h>
+
+#include "doomtype.h"
+
+// Picks the fastest kernel supported by the CPU
+void I_InitPaletteConversion(void);
+
+void I_ExpandPaletteRow(const byte *src, uint32_t *dst, int width,
+                        const uint32_t *palette);
+
+#endif
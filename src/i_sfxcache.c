@@ -0,0 +1,440 @@
+//
+//  Copyright(C) 2024 Alaux
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  On-disk cache of decoded sound effects
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#include "d_main.h"
+#include "i_printf.h"
+#include "i_sfxcache.h"
+#include "i_system.h"
+#include "m_array.h"
+#include "m_io.h"
+#include "m_misc.h"
+
+// File layout, all little-endian: magic, decoder flags, entry count, the
+// index of entries, and then the sample data that they point to
+#define CACHE_FILENAME "sfxcache.bin"
+#define CACHE_MAGIC    "NUGSFX02" // Bump along with the decoding output
+#define MAGIC_LEN      8
+#define HEADER_LEN     (MAGIC_LEN + 8)
+#define INDEX_ENTRY_LEN 28
+
+// The decoder only outputs float samples if the device supports them, so a
+// file written for another device may hold unplayable ones
+#define FLAG_FLOAT32 0x1
+
+// Sample data kept in the file; sounds used in the session go first
+#define CACHE_MAX_BYTES (256u << 20)
+
+// Entries are chained by hash, like the lump names in w_wad.c
+#define NUM_BUCKETS 1024
+
+boolean snd_disk_cache;
+
+typedef struct
+{
+    uint64_t hash;
+    uint32_t lumplen;
+    uint32_t format, freq, size;
+
+    uint32_t offset; // In the file, for entries read from it
+    byte *data;      // Otherwise, samples added in this session
+
+    boolean used;
+
+    int next; // Index of the next entry in the same bucket, or -1
+} sfxcache_entry_t;
+
+static sfxcache_entry_t *entries;
+static int buckets[NUM_BUCKETS];
+static uint32_t new_bytes;
+static boolean dirty;
+
+static FILE *cache_file;
+static char *cache_path;
+static SDL_mutex *cache_lock;
+static uint32_t cache_flags;
+
+static uint32_t GetU32(const byte *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void PutU32(byte *p, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        p[i] = (value >> (i * 8)) & 0xff;
+    }
+}
+
+static int BucketOf(uint64_t hash)
+{
+    return (hash ^ (hash >> 32)) & (NUM_BUCKETS - 1);
+}
+
+static void AddEntry(sfxcache_entry_t *entry)
+{
+    const int bucket = BucketOf(entry->hash);
+
+    entry->next = buckets[bucket];
+    buckets[bucket] = array_size(entries);
+    array_push(entries, *entry);
+}
+
+static void CloseCacheFile(void)
+{
+    if (cache_file)
+    {
+        fclose(cache_file);
+        cache_file = NULL;
+    }
+
+    for (int i = 0; i < array_size(entries); i++)
+    {
+        free(entries[i].data);
+    }
+
+    array_clear(entries);
+
+    for (int i = 0; i < NUM_BUCKETS; i++)
+    {
+        buckets[i] = -1;
+    }
+}
+
+// Reads the index of the cache file, leaving it open for the lookups
+static void OpenCacheFile(void)
+{
+    byte header[HEADER_LEN];
+    uint32_t count;
+    long file_len;
+
+    cache_file = M_fopen(cache_path, "rb");
+
+    if (!cache_file)
+    {
+        return;
+    }
+
+    if (fseek(cache_file, 0, SEEK_END) || (file_len = ftell(cache_file)) < 0
+        || fseek(cache_file, 0, SEEK_SET)
+        || fread(header, sizeof(header), 1, cache_file) != 1
+        || memcmp(header, CACHE_MAGIC, MAGIC_LEN)
+        || GetU32(header + MAGIC_LEN) != cache_flags)
+    {
+        CloseCacheFile();
+        return;
+    }
+
+    count = GetU32(header + MAGIC_LEN + 4);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        byte raw[INDEX_ENTRY_LEN];
+        sfxcache_entry_t entry = {0};
+
+        if (fread(raw, sizeof(raw), 1, cache_file) != 1)
+        {
+            CloseCacheFile();
+            return;
+        }
+
+        entry.hash = GetU32(raw) | ((uint64_t)GetU32(raw + 4) << 32);
+        entry.lumplen = GetU32(raw + 8);
+        entry.format = GetU32(raw + 12);
+        entry.freq = GetU32(raw + 16);
+        entry.size = GetU32(raw + 20);
+        entry.offset = GetU32(raw + 24);
+
+        if ((uint64_t)entry.offset + entry.size > (uint64_t)file_len)
+        {
+            CloseCacheFile();
+            return;
+        }
+
+        AddEntry(&entry);
+    }
+
+    I_Printf(VB_DEBUG, "I_InitSfxCache: %d cached sounds", array_size(entries));
+}
+
+// After the sound modules, which flush the cache when shut down
+static void ShutdownSfxCache(void)
+{
+    SDL_LockMutex(cache_lock);
+    CloseCacheFile();
+    SDL_UnlockMutex(cache_lock);
+}
+
+void I_InitSfxCache(void)
+{
+    if (!snd_disk_cache || cache_lock)
+    {
+        return;
+    }
+
+    cache_lock = SDL_CreateMutex();
+
+    if (!cache_lock)
+    {
+        I_Printf(VB_WARNING, "I_InitSfxCache: %s", SDL_GetError());
+        return;
+    }
+
+    cache_path = M_StringJoin(D_DoomPrefDir(), DIR_SEPARATOR_S, CACHE_FILENAME);
+
+    if (alIsExtensionPresent("AL_EXT_FLOAT32"))
+    {
+        cache_flags |= FLAG_FLOAT32;
+    }
+
+    CloseCacheFile(); // Empties the buckets
+    OpenCacheFile();
+
+    I_AtExitPrio(ShutdownSfxCache, true, "ShutdownSfxCache",
+                 exit_priority_last);
+}
+
+// Must be called with the lock held
+static sfxcache_entry_t *FindEntry(uint64_t hash, int lumplen)
+{
+    for (int i = buckets[BucketOf(hash)]; i >= 0; i = entries[i].next)
+    {
+        if (entries[i].hash == hash && entries[i].lumplen == (uint32_t)lumplen)
+        {
+            return &entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+boolean I_LoadCachedSfx(uint64_t hash, int lumplen, ALenum *format,
+                        byte **data, ALsizei *size, ALsizei *freq)
+{
+    sfxcache_entry_t *entry;
+    boolean result = false;
+
+    if (!cache_lock)
+    {
+        return false;
+    }
+
+    SDL_LockMutex(cache_lock);
+
+    if ((entry = FindEntry(hash, lumplen)) && entry->size)
+    {
+        byte *buffer = malloc(entry->size);
+
+        if (entry->data)
+        {
+            memcpy(buffer, entry->data, entry->size);
+            result = true;
+        }
+        else
+        {
+            result = !fseek(cache_file, entry->offset, SEEK_SET)
+                     && fread(buffer, entry->size, 1, cache_file) == 1;
+        }
+
+        if (result)
+        {
+            *format = entry->format;
+            *data = buffer;
+            *size = entry->size;
+            *freq = entry->freq;
+            entry->used = true;
+        }
+        else
+        {
+            free(buffer);
+        }
+    }
+
+    SDL_UnlockMutex(cache_lock);
+
+    return result;
+}
+
+void I_StoreCachedSfx(uint64_t hash, int lumplen, ALenum format,
+                      const byte *data, ALsizei size, ALsizei freq)
+{
+    if (!cache_lock || size <= 0)
+    {
+        return;
+    }
+
+    SDL_LockMutex(cache_lock);
+
+    if (!FindEntry(hash, lumplen) && new_bytes + size <= CACHE_MAX_BYTES)
+    {
+        sfxcache_entry_t entry = {
+            .hash = hash,
+            .lumplen = lumplen,
+            .format = format,
+            .freq = freq,
+            .size = size,
+            .data = malloc(size),
+            .used = true,
+        };
+
+        memcpy(entry.data, data, size);
+        AddEntry(&entry);
+
+        new_bytes += size;
+        dirty = true;
+    }
+
+    SDL_UnlockMutex(cache_lock);
+}
+
+// Must be called with the lock held
+static boolean WriteCacheFile(const char *path, sfxcache_entry_t **keep)
+{
+    const int count = array_size(keep);
+    uint32_t offset = HEADER_LEN + count * INDEX_ENTRY_LEN;
+    byte raw[INDEX_ENTRY_LEN];
+    byte *buffer = NULL;
+    boolean result = true;
+    FILE *file;
+
+    if (!(file = M_fopen(path, "wb")))
+    {
+        return false;
+    }
+
+    fwrite(CACHE_MAGIC, MAGIC_LEN, 1, file);
+    PutU32(raw, cache_flags);
+    PutU32(raw + 4, count);
+    fwrite(raw, 8, 1, file);
+
+    for (int i = 0; i < count; i++)
+    {
+        const sfxcache_entry_t *entry = keep[i];
+
+        PutU32(raw, entry->hash & 0xffffffff);
+        PutU32(raw + 4, entry->hash >> 32);
+        PutU32(raw + 8, entry->lumplen);
+        PutU32(raw + 12, entry->format);
+        PutU32(raw + 16, entry->freq);
+        PutU32(raw + 20, entry->size);
+        PutU32(raw + 24, offset);
+        fwrite(raw, sizeof(raw), 1, file);
+
+        offset += entry->size;
+    }
+
+    for (int i = 0; i < count && result; i++)
+    {
+        const sfxcache_entry_t *entry = keep[i];
+        const byte *data = entry->data;
+
+        if (!data)
+        {
+            buffer = I_Realloc(buffer, entry->size);
+            data = buffer;
+
+            result = !fseek(cache_file, entry->offset, SEEK_SET)
+                     && fread(buffer, entry->size, 1, cache_file) == 1;
+        }
+
+        result = result && fwrite(data, entry->size, 1, file) == 1;
+    }
+
+    free(buffer);
+
+    return (fclose(file) == 0) && result;
+}
+
+void I_FlushSfxCache(void)
+{
+    sfxcache_entry_t **keep = NULL;
+    uint32_t total = 0;
+    int num_used = 0;
+    char *temp_path;
+
+    if (!cache_lock)
+    {
+        return;
+    }
+
+    SDL_LockMutex(cache_lock);
+
+    if (!dirty)
+    {
+        SDL_UnlockMutex(cache_lock);
+        return;
+    }
+
+    // Sounds used in this session first, then older ones while they fit
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < array_size(entries); i++)
+        {
+            sfxcache_entry_t *entry = &entries[i];
+
+            if (entry->used == !pass && total + entry->size <= CACHE_MAX_BYTES)
+            {
+                array_push(keep, entry);
+                total += entry->size;
+                num_used += !pass;
+            }
+        }
+    }
+
+    temp_path = M_StringJoin(cache_path, ".tmp");
+
+    if (WriteCacheFile(temp_path, keep))
+    {
+        CloseCacheFile();
+        M_remove(cache_path);
+
+        if (M_rename(temp_path, cache_path))
+        {
+            I_Printf(VB_WARNING, "I_FlushSfxCache: Failed to write %s",
+                     cache_path);
+        }
+    }
+    else
+    {
+        I_Printf(VB_WARNING, "I_FlushSfxCache: Failed to write %s", temp_path);
+        M_remove(temp_path);
+    }
+
+    free(temp_path);
+    array_free(keep);
+
+    // Everything is in the file now, or wasn't worth keeping
+    CloseCacheFile();
+    OpenCacheFile();
+
+    // The file starts with the sounds used so far
+    for (int i = 0; i < MIN(num_used, array_size(entries)); i++)
+    {
+        entries[i].used = true;
+    }
+
+    new_bytes = 0;
+    dirty = false;
+
+    SDL_UnlockMutex(cache_lock);
+}
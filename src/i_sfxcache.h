@@ -0,0 +1,45 @@
+//
+//  Copyright(C) 2024 Alaux
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  On-disk cache of decoded sound effects
+//
+
+#ifndef __I_SFXCACHE__
+#define __I_SFXCACHE__
+
+#include <stdint.h>
+
+#include "al.h"
+
+#include "doomtype.h"
+
+extern boolean snd_disk_cache;
+
+void I_InitSfxCache(void);
+
+// Lumps are identified by `M_HashData()` of their contents.
+
+// Gets the decoded samples of a lump from the cache into a newly allocated
+// buffer, returning false if they aren't cached. Safe to call from any thread.
+boolean I_LoadCachedSfx(uint64_t hash, int lumplen, ALenum *format,
+                        byte **data, ALsizei *size, ALsizei *freq);
+
+// Adds the decoded samples of a lump to the cache; they are only written to
+// disk by I_FlushSfxCache(). Safe to call from any thread.
+void I_StoreCachedSfx(uint64_t hash, int lumplen, ALenum format,
+                      const byte *data, ALsizei size, ALsizei freq);
+
+void I_FlushSfxCache(void);
+
+#endif
@@ -23,6 +23,7 @@
 #include "i_sndfile.h"
 
 #include <math.h>
+#include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -31,6 +32,7 @@
 #include "config.h"
 #include "i_oalstream.h"
 #include "i_printf.h"
+#include "m_misc.h"
 #include "m_swap.h"
 #include "memio.h"
 
@@ -294,7 +296,7 @@ static sf_count_t sfx_mix_mono_read_float(SNDFILE *file, float *data,
         return sf_readf_float(file, data, datalen);
     }
 
-    static float multi_data[2048];
+    float multi_data[2048]; // [Nugget] Not static, sounds are decoded in parallel
     int k, ch, frames_read;
     sf_count_t dataout = 0;
 
@@ -340,7 +342,7 @@ static sf_count_t sfx_mix_mono_read_short(SNDFILE *file, short *data,
         return sf_readf_short(file, data, datalen);
     }
 
-    static short multi_data[2048];
+    short multi_data[2048]; // [Nugget] Not static, sounds are decoded in parallel
     int k, ch, frames_read;
     sf_count_t dataout = 0;
 
@@ -407,7 +409,30 @@ static void CloseFile(sndfile_t *file)
     }
 }
 
-static boolean OpenFile(sndfile_t *file, void *data, sf_count_t size)
+// [Nugget] Sound effects are loaded on worker threads, where printing is not
+// safe; those callers pass a buffer to receive the message instead
+
+static void FileError(char *error, size_t error_size, verbosity_t prio,
+                      const char *msg, ...)
+{
+    char buffer[128];
+    va_list args;
+
+    va_start(args, msg);
+    if (error)
+    {
+        M_vsnprintf(error, error_size, msg, args);
+    }
+    else
+    {
+        M_vsnprintf(buffer, sizeof(buffer), msg, args);
+        I_Printf(prio, "%s", buffer);
+    }
+    va_end(args);
+}
+
+static boolean OpenFile(sndfile_t *file, void *data, sf_count_t size,
+                        char *error, size_t error_size)
 {
     sample_format_t sample_format;
     ALenum format;
@@ -421,7 +446,8 @@ static boolean OpenFile(sndfile_t *file, void *data, sf_count_t size)
 
     if (!file->sndfile)
     {
-        I_Printf(VB_DEBUG, "SndFile: %s", sf_strerror(file->sndfile));
+        FileError(error, error_size, VB_DEBUG, "SndFile: %s",
+                  sf_strerror(file->sndfile));
         return false;
     }
 
@@ -509,8 +535,9 @@ static boolean OpenFile(sndfile_t *file, void *data, sf_count_t size)
 
     if (format == AL_NONE)
     {
-        I_Printf(VB_ERROR, "SndFile: Unsupported channel count %d.",
-                 file->sfinfo.channels);
+        FileError(error, error_size, VB_ERROR,
+                  "SndFile: Unsupported channel count %d.",
+                  file->sfinfo.channels);
         return false;
     }
 
@@ -578,13 +605,14 @@ static void FadeInOutMonoFloat32(float *data, ALsizei size, ALsizei freq)
 }
 
 boolean I_SND_LoadFile(void *data, ALenum *format, byte **wavdata,
-                       ALsizei *size, ALsizei *freq)
+                       ALsizei *size, ALsizei *freq, char *error,
+                       size_t error_size)
 {
     sndfile_t file = {0};
     sf_count_t num_frames = 0;
     void *local_wavdata = NULL;
 
-    if (OpenFile(&file, data, *size) == false)
+    if (OpenFile(&file, data, *size, error, error_size) == false)
     {
         CloseFile(&file);
         return false;
@@ -608,7 +636,8 @@ boolean I_SND_LoadFile(void *data, ALenum *format, byte **wavdata,
 
     if (num_frames < file.sfinfo.frames)
     {
-        I_Printf(VB_ERROR, "sf_readf: %s", sf_strerror(file.sndfile));
+        FileError(error, error_size, VB_ERROR, "sf_readf: %s",
+                  sf_strerror(file.sndfile));
         CloseFile(&file);
         free(local_wavdata);
         return false;
@@ -649,7 +678,7 @@ static boolean I_SND_OpenStream(void *data, ALsizei size, ALenum *format,
 {
     MEMFILE *fs;
 
-    if (OpenFile(&stream, data, size) == false)
+    if (OpenFile(&stream, data, size, NULL, 0) == false)
     {
         CloseFile(&stream);
         return false;
@@ -26,6 +26,7 @@
 #define FADETIME 1000 // microseconds
 
 boolean I_SND_LoadFile(void *data, ALenum *format, byte **wavdata,
-                       ALsizei *size, ALsizei *freq);
+                       ALsizei *size, ALsizei *freq, char *error,
+                       size_t error_size);
 
 #endif
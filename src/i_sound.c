@@ -25,9 +25,11 @@
 
 #include "doomstat.h"
 #include "doomtype.h"
+#include "i_muscache.h"
 #include "i_oalstream.h"
 #include "i_printf.h"
 #include "i_rumble.h"
+#include "i_sfxcache.h"
 #include "i_system.h"
 #include "m_array.h"
 #include "mn_menu.h"
@@ -95,6 +97,9 @@ boolean force_flip_pan; // Brought over from i_mbfsound.c, global
 int S_CLIPPING_DIST;
 int S_ATTENUATOR;
 
+// [Nugget] Decode sound effects on first use instead of at startup
+static boolean snd_lazy_cache;
+
 // Pitch to stepping lookup.
 static float steptable[256];
 
@@ -459,19 +464,45 @@ void I_InitSound(void)
         return;
     }
 
+    I_InitSfxCache(); // [Nugget]
+
     // [FG] precache all sound effects
 
-    I_Printf(VB_INFO, " Precaching all sound effects... ");
-    for (int i = 1; i < num_sfx; i++)
+    // [Nugget] Or leave them for later, decoding them in parallel otherwise
+    if (snd_lazy_cache)
+    {
+        I_Printf(VB_INFO, " Sound effects will be cached on first use.");
+    }
+    else
     {
-        // DEHEXTRA has turned S_sfx into a sparse array
-        if (!S_sfx[i].name)
+        sfxinfo_t **sfx = NULL;
+
+        I_Printf(VB_INFO, " Precaching all sound effects... ");
+        for (int i = 1; i < num_sfx; i++)
+        {
+            // DEHEXTRA has turned S_sfx into a sparse array
+            if (!S_sfx[i].name)
+            {
+                continue;
+            }
+
+            if (sound_module->PrecacheSounds)
+            {
+                array_push(sfx, &S_sfx[i]);
+            }
+            else
+            {
+                sound_module->CacheSound(&S_sfx[i]);
+            }
+        }
+
+        if (sfx)
         {
-            continue;
+            sound_module->PrecacheSounds(sfx, array_size(sfx), true);
+            array_free(sfx);
         }
-        sound_module->CacheSound(&S_sfx[i]);
+        I_Printf(VB_INFO, "done.");
     }
-    I_Printf(VB_INFO, "done.");
 
     // [FG] add links for likely missing sounds
     for (int i = 0; i < arrlen(sfx_subst); i++)
@@ -479,13 +510,24 @@ void I_InitSound(void)
         sfxinfo_t *from = &S_sfx[sfx_subst[i].from],
                   *to = &S_sfx[sfx_subst[i].to];
 
-        if (from->lumpnum == -1)
+        if (I_GetSfxLumpNum(from) == -1) // [Nugget] Not necessarily cached
         {
             from->link = to;
         }
     }
 }
 
+// [Nugget]
+void I_PrefetchSounds(sfxinfo_t **sfx, int num)
+{
+    if (!snd_init || !snd_lazy_cache || !sound_module->PrecacheSounds)
+    {
+        return;
+    }
+
+    sound_module->PrecacheSounds(sfx, num, false);
+}
+
 boolean I_AllowReinitSound(void)
 {
     if (!snd_init)
@@ -606,6 +648,8 @@ boolean I_InitMusic(void)
     // Always initialize the OpenAL module, it is used for software synth and
     // non-MIDI music streaming.
 
+    I_InitMusCache(); // [Nugget] Before any song can be opened
+
     I_OAL_InitStream();
 
     I_AtExit(I_ShutdownMusic, true);
@@ -622,6 +666,8 @@ boolean I_InitMusic(void)
 
     I_SetMidiPlayer();
 
+    I_OAL_BenchmarkMusic(); // [Nugget]
+
     return true;
 }
 
@@ -758,6 +804,19 @@ void I_BindSoundVariables(void)
     // [Nugget]
     BIND_BOOL_GENERAL(s_clipping_dist_x2, false, "Double sound-clipping distance");
 
+    // [Nugget] (CFG-only)
+    BIND_BOOL(snd_lazy_cache, false,
+        "Decode sound effects on first use instead of at startup");
+
+    // [Nugget] (CFG-only)
+    BIND_BOOL(snd_disk_cache, true,
+        "Keep decoded sound effects in a cache file for later launches");
+
+    // [Nugget] (CFG-only)
+    BIND_NUM(snd_merge_dist, 16, 0, 1024,
+        "Merge identical sounds started in the same tic within this distance "
+        "in map units (0 = Off)");
+
     BIND_NUM_SFX(snd_channels, MAX_CHANNELS, 1, MAX_CHANNELS,
         "Maximum number of simultaneous sound effects");
     BIND_NUM_GENERAL(snd_module, SND_MODULE_MBF, 0, NUM_SND_MODULES - 1,
@@ -80,6 +80,8 @@ typedef struct sound_module_s
     boolean (*ReinitSound)(void);
     boolean (*AllowReinitSound)(void);
     boolean (*CacheSound)(struct sfxinfo_s *sfx);
+    // [Nugget] Optional; decodes in parallel, uploading right away if `wait`
+    void (*PrecacheSounds)(struct sfxinfo_s **sfx, int num, boolean wait);
     boolean (*AdjustSoundParams)(const struct mobj_s *listener,
                                  const struct mobj_s *source, int chanvol,
                                  int *vol, int *sep, int *pri);
@@ -118,6 +120,10 @@ void I_SetChannels(void);
 // Get raw data lump index for sound descriptor.
 int I_GetSfxLumpNum(struct sfxinfo_s *sfxinfo);
 
+// [Nugget] When sounds are cached on first use, decode the given ones in the
+// background so that they are ready by the time they are played
+void I_PrefetchSounds(struct sfxinfo_s **sfx, int num);
+
 // Starts a sound in a particular sound channel.
 int I_StartSound(struct sfxinfo_s *sound, int vol, int sep, int pitch);
 
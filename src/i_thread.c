@@ -0,0 +1,301 @@
+//
+//  Copyright(C) 2024 Alaux
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Worker thread pool
+//
+
+#include "SDL.h"
+
+#include "i_printf.h"
+#include "i_system.h"
+#include "i_thread.h"
+#include "m_array.h"
+#include "m_argv.h"
+
+#define MAX_WORKERS 8
+
+typedef struct
+{
+    jobfunc_t func;
+    void *data;
+    boolean *done;
+} job_t;
+
+static SDL_Thread *workers[MAX_WORKERS];
+static int num_workers;
+
+static SDL_mutex *pool_lock;
+static SDL_cond *job_queued, *job_finished;
+
+// Jobs are taken from `queue_head` onwards; the array is emptied once
+// everything in it has been taken. A job taken out of order by its waiter
+// is left in place with a NULL `func`.
+static job_t *queue;
+static int queue_head;
+static int jobs_queued, jobs_running;
+static boolean shutting_down;
+
+// Must be called with the lock held
+static boolean TakeJob(job_t *job)
+{
+    boolean found = false;
+
+    while (!found && queue_head < array_size(queue))
+    {
+        *job = queue[queue_head++];
+        found = (job->func != NULL);
+    }
+
+    if (queue_head == array_size(queue))
+    {
+        array_clear(queue);
+        queue_head = 0;
+    }
+
+    if (found)
+    {
+        jobs_queued--;
+        jobs_running++;
+    }
+
+    return found;
+}
+
+// Takes the job that sets `done`, if no worker has started it yet. Must be
+// called with the lock held.
+static boolean TakeOwnJob(const boolean *done, job_t *job)
+{
+    for (int i = queue_head; i < array_size(queue); i++)
+    {
+        if (queue[i].func && queue[i].done == done)
+        {
+            *job = queue[i];
+            queue[i].func = NULL;
+
+            jobs_queued--;
+            jobs_running++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Runs the job with the lock released; must be called with the lock held
+static void RunJob(job_t *job)
+{
+    SDL_UnlockMutex(pool_lock);
+    job->func(job->data);
+    SDL_LockMutex(pool_lock);
+
+    if (job->done)
+    {
+        *job->done = true;
+    }
+
+    jobs_running--;
+    SDL_CondBroadcast(job_finished);
+}
+
+static int WorkerThread(void *unused)
+{
+    job_t job;
+
+    SDL_LockMutex(pool_lock);
+
+    while (!shutting_down)
+    {
+        if (TakeJob(&job))
+        {
+            RunJob(&job);
+        }
+        else
+        {
+            SDL_CondWait(job_queued, pool_lock);
+        }
+    }
+
+    SDL_UnlockMutex(pool_lock);
+
+    return 0;
+}
+
+static void ShutdownThreadPool(void)
+{
+    if (!num_workers)
+    {
+        return;
+    }
+
+    SDL_LockMutex(pool_lock);
+    shutting_down = true;
+    SDL_CondBroadcast(job_queued);
+    SDL_UnlockMutex(pool_lock);
+
+    for (int i = 0; i < num_workers; i++)
+    {
+        SDL_WaitThread(workers[i], NULL);
+    }
+
+    num_workers = 0;
+    array_free(queue);
+}
+
+void I_InitThreadPool(void)
+{
+    //!
+    // @arg <n>
+    // @category obscure
+    //
+    // Number of worker threads used for background jobs such as sound
+    // decoding. 0 runs them on the main thread.
+    //
+
+    int p = M_CheckParmWithArgs("-threads", 1);
+    int count;
+
+    if (p)
+    {
+        count = M_ParmArgToInt(p);
+    }
+    else
+    {
+        // Leave one core to the main thread
+        count = SDL_GetCPUCount() - 1;
+    }
+
+    count = BETWEEN(0, MAX_WORKERS, count);
+
+    if (!count)
+    {
+        return;
+    }
+
+    pool_lock = SDL_CreateMutex();
+    job_queued = SDL_CreateCond();
+    job_finished = SDL_CreateCond();
+
+    if (!pool_lock || !job_queued || !job_finished)
+    {
+        I_Printf(VB_WARNING, "I_InitThreadPool: %s", SDL_GetError());
+        return;
+    }
+
+    for (num_workers = 0; num_workers < count; num_workers++)
+    {
+        SDL_Thread *thread = SDL_CreateThread(WorkerThread, "worker", NULL);
+
+        if (!thread)
+        {
+            I_Printf(VB_WARNING, "I_InitThreadPool: %s", SDL_GetError());
+            break;
+        }
+
+        workers[num_workers] = thread;
+    }
+
+    if (num_workers)
+    {
+        I_AtExit(ShutdownThreadPool, true);
+    }
+
+    I_Printf(VB_DEBUG, "I_InitThreadPool: %d worker threads", num_workers);
+}
+
+int I_NumWorkerThreads(void)
+{
+    return num_workers;
+}
+
+void I_QueueJob(jobfunc_t func, void *data, boolean *done)
+{
+    if (!num_workers)
+    {
+        func(data);
+
+        if (done)
+        {
+            *done = true;
+        }
+
+        return;
+    }
+
+    const job_t job = {func, data, done};
+
+    SDL_LockMutex(pool_lock);
+    array_push(queue, job);
+    jobs_queued++;
+    SDL_CondSignal(job_queued);
+    SDL_UnlockMutex(pool_lock);
+}
+
+boolean I_JobDone(const boolean *done)
+{
+    boolean result;
+
+    if (!num_workers)
+    {
+        return *done;
+    }
+
+    SDL_LockMutex(pool_lock);
+    result = *done;
+    SDL_UnlockMutex(pool_lock);
+
+    return result;
+}
+
+void I_WaitForJob(const boolean *done)
+{
+    job_t job;
+
+    if (!num_workers)
+    {
+        return;
+    }
+
+    SDL_LockMutex(pool_lock);
+
+    // Only the awaited job is run here, since waiters may have deadlines
+    // that unrelated jobs would make them miss
+    if (!*done && TakeOwnJob(done, &job))
+    {
+        RunJob(&job);
+    }
+
+    while (!*done)
+    {
+        SDL_CondWait(job_finished, pool_lock);
+    }
+
+    SDL_UnlockMutex(pool_lock);
+}
+
+void I_WaitForJobs(void)
+{
+    if (!num_workers)
+    {
+        return;
+    }
+
+    SDL_LockMutex(pool_lock);
+
+    while (jobs_queued || jobs_running)
+    {
+        SDL_CondWait(job_finished, pool_lock);
+    }
+
+    SDL_UnlockMutex(pool_lock);
+}
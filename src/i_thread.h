@@ -0,0 +1,43 @@
+//
+//  Copyright(C) 2024 Alaux
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Worker thread pool
+//
+
+#ifndef __I_THREAD__
+#define __I_THREAD__
+
+#include "doomtype.h"
+
+typedef void (*jobfunc_t)(void *data);
+
+void I_InitThreadPool(void);
+
+// Number of worker threads; 0 means that jobs run on the queuing thread
+int I_NumWorkerThreads(void);
+
+// Queues `func(data)` to be run by a worker. If `done` is not NULL, it is
+// set to true once the job has finished; use the functions below to check
+// it, since it is written under the pool's lock.
+void I_QueueJob(jobfunc_t func, void *data, boolean *done);
+
+boolean I_JobDone(const boolean *done);
+
+// Block until the given job, or every queued job, has finished. If the given
+// job hasn't started yet, the calling thread runs it itself; it never runs
+// other jobs. Real-time threads shouldn't wait on the pool at all.
+void I_WaitForJob(const boolean *done);
+void I_WaitForJobs(void);
+
+#endif
@@ -25,9 +25,12 @@
 
 #include "SDL.h"
 
+#include <errno.h>
 #include <limits.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "am_map.h"
 #include "config.h"
@@ -36,9 +39,12 @@
 #include "doomdef.h"
 #include "doomstat.h"
 #include "g_game.h"
+#include "i_capture.h" // [Nugget]
 #include "i_input.h"
+#include "i_palconv.h" // [Nugget]
 #include "i_printf.h"
 #include "i_system.h"
+#include "i_thread.h" // [Nugget]
 #include "i_timer.h"
 #include "i_video.h"
 #include "m_argv.h"
@@ -46,10 +52,12 @@
 #include "m_fixed.h"
 #include "m_io.h"
 #include "m_misc.h"
+#include "m_perf.h" // [Nugget]
 #include "mn_menu.h"
 #include "r_draw.h"
 #include "r_main.h"
 #include "r_plane.h"
+#include "r_things.h"
 #include "r_voxel.h"
 #include "st_stuff.h"
 #include "v_fmt.h"
@@ -69,6 +77,9 @@ fixed_t fractionaltic;
 
 boolean dynamic_resolution;
 
+// [Nugget] Lets dynamic resolution drop the translucency of far sprites
+static boolean dynamic_sprite_detail;
+
 int current_video_height;
 static int default_current_video_height;
 static int GetCurrentVideoHeight(void);
@@ -104,6 +115,9 @@ static const char *sdl_renderdriver = "";
 static int red_intensity, green_intensity, blue_intensity;
 static int color_saturation;
 
+// Only upload the rows of menu and intermission frames that changed
+static boolean dirty_row_upload;
+
 // [Nugget] -----------------------------------------------------------------/
 
 // [FG] rendering window, renderer, intermediate ARGB frame buffer and texture
@@ -111,11 +125,16 @@ static int color_saturation;
 static SDL_Window *screen;
 static SDL_Renderer *renderer;
 static SDL_Surface *screenbuffer;
-static SDL_Surface *argbbuffer;
 static SDL_Texture *texture;
 static SDL_Texture *texture_upscaled;
 static SDL_Rect blit_rect = {0};
 
+// [Nugget] Palette as ARGB8888, and copy of the last frame uploaded to the
+// texture when tracking the rows that changed
+static uint32_t argb_palette[256];
+static byte *last_frame;
+static boolean full_upload = true;
+
 static int window_x, window_y;
 static int window_width, window_height;
 static int default_window_width, default_window_height;
@@ -531,6 +550,12 @@ static void ProcessEvent(SDL_Event *ev)
             }
             break;
 
+        // [Nugget] Texture contents may have been lost
+        case SDL_RENDER_TARGETS_RESET:
+        case SDL_RENDER_DEVICE_RESET:
+            full_upload = true;
+            break;
+
         default:
             break;
     }
@@ -666,16 +691,85 @@ void I_StartFrame(void)
     ;
 }
 
+// [Nugget] Narrows `rect` down to the rows that changed since the last
+// upload, returning false if none did
+static boolean FindDirtyRows(SDL_Rect *rect)
+{
+    const int pitch = screenbuffer->pitch;
+    const byte *frame = screenbuffer->pixels;
+    int top, bottom;
+
+    // Gameplay frames change almost entirely, don't spend time comparing
+    if (!dirty_row_upload
+        || (gamestate == GS_LEVEL && !paused && !menuactive))
+    {
+        full_upload = true;
+        return true;
+    }
+
+    if (full_upload)
+    {
+        memcpy(last_frame, frame, (size_t)pitch * screenbuffer->h);
+        full_upload = false;
+        return true;
+    }
+
+    for (top = rect->y; top < rect->y + rect->h; top++)
+    {
+        if (memcmp(frame + top * pitch, last_frame + top * pitch, rect->w))
+        {
+            break;
+        }
+    }
+
+    if (top == rect->y + rect->h)
+    {
+        return false;
+    }
+
+    for (bottom = rect->y + rect->h - 1; bottom > top; bottom--)
+    {
+        if (memcmp(frame + bottom * pitch, last_frame + bottom * pitch,
+                   rect->w))
+        {
+            break;
+        }
+    }
+
+    memcpy(last_frame + top * pitch, frame + top * pitch,
+           (size_t)pitch * (bottom - top + 1));
+
+    rect->y = top;
+    rect->h = bottom - top + 1;
+
+    return true;
+}
+
 static void UpdateRender(void)
 {
-    // Blit from the paletted 8-bit screen buffer to the intermediate
-    // 32-bit RGBA buffer and update the intermediate texture with the
-    // contents of the RGBA buffer.
+    // [Nugget] Expand the paletted 8-bit screen buffer straight into the
+    // intermediate texture, skipping the rows that haven't changed
+
+    SDL_Rect rect = blit_rect;
+
+    if (FindDirtyRows(&rect))
+    {
+        void *pixels;
+        int pitch;
+
+        SDL_LockTexture(texture, &rect, &pixels, &pitch);
+
+        for (int y = 0; y < rect.h; y++)
+        {
+            const byte *src = (byte *)screenbuffer->pixels
+                              + (rect.y + y) * screenbuffer->pitch + rect.x;
 
-    SDL_LockTexture(texture, &blit_rect, &argbbuffer->pixels,
-                    &argbbuffer->pitch);
-    SDL_LowerBlit(screenbuffer, &blit_rect, argbbuffer, &blit_rect);
-    SDL_UnlockTexture(texture);
+            I_ExpandPaletteRow(src, (uint32_t *)((byte *)pixels + y * pitch),
+                               rect.w, argb_palette);
+        }
+
+        SDL_UnlockTexture(texture);
+    }
 
     SDL_RenderClear(renderer);
 
@@ -703,11 +797,68 @@ static uint64_t frametime_start, frametime_withoutpresent;
 static void ResetResolution(int height, boolean reset_pitch);
 static void ResetLogicalSize(void);
 
+// [Nugget] Dynamic resolution controller
+//
+// The frame cost is split into a part that scales with the number of pixels
+// (wall columns, planes, masked, upload) and a fixed part, using the stage
+// timings from m_perf.c. Both are smoothed with EWMAs. The pixel part is
+// further scaled by the ratio of the current scene complexity (segs,
+// visplanes, vissprites) to its average, so a sudden jump is predicted from
+// the counts before the averages catch up. The resolution only changes when
+// the predicted load leaves a hysteresis band, and voxel distance and sprite
+// detail are traded away before resolution is.
+
+#define DRS_ALPHA       0.2  // EWMA weight of the newest frame
+#define DRS_HIGH        1.0  // Predicted load above which detail is lowered
+#define DRS_LOW         0.75 // Predicted load below which detail is raised
+#define DRS_AIM         0.85 // Load to aim for when picking a new height
+#define DRS_MAX_GROWTH  1.25 // Largest upscale per step
+#define DRS_STEP        (SCREENHEIGHT / 2)
+
+static struct
+{
+    double pixel_time; // Microseconds spent in resolution-bound stages
+    double fixed_time; // Microseconds spent elsewhere
+    double complexity;
+    int low_frames;    // Consecutive frames below DRS_LOW
+    int cooldown;      // Frames to let the averages settle after a change
+    boolean voxels_reduced;
+} drs;
+
+static void ResetDRS(void)
+{
+    if (drs.voxels_reduced)
+    {
+        VX_IncreaseMaxDist();
+    }
+
+    reduced_sprite_detail = false;
+    memset(&drs, 0, sizeof(drs));
+}
+
+static double Ewma(double average, double value)
+{
+    return average ? average + (value - average) * DRS_ALPHA : value;
+}
+
+static double SceneComplexity(void)
+{
+    return rendered_segs + rendered_visplanes + rendered_vissprites * 4.0
+           + rendered_voxels * 16.0 + 1.0;
+}
+
+static int QuantizeHeight(double height)
+{
+    const int newheight = (int)height / DRS_STEP * DRS_STEP;
+    return BETWEEN(DRS_MIN_HEIGHT, current_video_height, newheight);
+}
+
 void I_DynamicResolution(void)
 {
     if (!dynamic_resolution || current_video_height <= DRS_MIN_HEIGHT
         || frametime_withoutpresent == 0 || targetrefresh <= 0
-        || menuactive)
+        || menuactive
+        || I_CaptureActive()) // [Nugget] Captured frames can't change size
     {
         return;
     }
@@ -716,53 +867,126 @@ void I_DynamicResolution(void)
     {
         frametime_start = frametime_withoutpresent = 0;
         drs_skip_frame = false;
+        drs.low_frames = 0;
         return;
     }
 
-    static int frame_counter;
-    static double averagepercent;
-
     // 1.25 milliseconds for SDL render present
-    double target = (1.0 / targetrefresh) - 0.00125;
-    double actual = frametime_withoutpresent / 1000000.0;
+    const double target = 1000000.0 / targetrefresh - 1250.0;
+    const double actual = frametime_withoutpresent;
+
+    double pixel_time = perf_last[PERF_BSP] + perf_last[PERF_PLANES]
+                        + perf_last[PERF_MASKED] + perf_last[PERF_UPLOAD];
 
-    double actualpercent = actual / target;
+    if (pixel_time <= 0.0 || pixel_time > actual)
+    {
+        // No stage timings yet, assume everything is resolution-bound
+        pixel_time = actual;
+    }
 
-    #define DRS_DELTA   0.1
-    #define DRS_GREATER (1 + DRS_DELTA)
-    #define DRS_LESS    (1 - DRS_DELTA / 10.0)
-    #define DRS_STEP    (SCREENHEIGHT / 2)
+    const double complexity = SceneComplexity();
 
-    int newheight = 0;
-    int oldheight = video.height;
+    drs.pixel_time = Ewma(drs.pixel_time, pixel_time);
+    drs.fixed_time = Ewma(drs.fixed_time, actual - pixel_time);
+    drs.complexity = Ewma(drs.complexity, complexity);
 
-    frame_counter++;
-    averagepercent = (averagepercent + actualpercent) / frame_counter;
+    const double predicted_pixel_time =
+        drs.pixel_time * BETWEEN(0.5, 2.0, complexity / drs.complexity);
+    const double load = (drs.fixed_time + predicted_pixel_time) / target;
 
-    if (actualpercent > DRS_GREATER)
+    if (drs.cooldown > 0)
     {
-        double reduction = (actualpercent - DRS_GREATER) * 0.4;
-        newheight = (int)MAX(DRS_MIN_HEIGHT, oldheight - oldheight * reduction);
+        drs.cooldown--;
+        return;
     }
-    else if (averagepercent < DRS_LESS && frame_counter > targetrefresh)
+
+    const int oldheight = video.height;
+    int newheight;
+
+    if (load > DRS_HIGH)
     {
-        double addition = (DRS_LESS - averagepercent) * 0.25;
-        newheight = (int)MIN(current_video_height, oldheight + oldheight * addition);
+        drs.low_frames = 0;
+
+        // Far voxels are the cheapest thing to give up if they make up a
+        // large part of the masked stage
+        if (!drs.voxels_reduced && rendered_voxels
+            && perf_last[PERF_MASKED] * 3 > pixel_time)
+        {
+            VX_DecreaseMaxDist();
+            drs.voxels_reduced = true;
+            drs.cooldown = targetrefresh / 4;
+            return;
+        }
+
+        if (dynamic_sprite_detail && !reduced_sprite_detail
+            && rendered_vissprites > 128)
+        {
+            reduced_sprite_detail = true;
+            drs.cooldown = targetrefresh / 4;
+            return;
+        }
+
+        if (oldheight <= DRS_MIN_HEIGHT)
+        {
+            return;
+        }
+
+        // Pixel-bound time scales with the square of the height
+        const double budget = MAX(DRS_AIM * target - drs.fixed_time,
+                                  0.1 * predicted_pixel_time);
+        newheight =
+            QuantizeHeight(oldheight * sqrt(budget / predicted_pixel_time));
+
+        if (newheight >= oldheight)
+        {
+            newheight = QuantizeHeight(oldheight - DRS_STEP);
+        }
     }
-    else
+    else if (load < DRS_LOW)
     {
-        return;
-    }
-
-    frame_counter = 0;
+        // Wait for half a second of headroom before raising detail
+        if (++drs.low_frames < targetrefresh / 2)
+        {
+            return;
+        }
 
-    int mul = (newheight + (DRS_STEP - 1)) / DRS_STEP;  // integer round
+        drs.low_frames = 0;
 
-    newheight = mul * DRS_STEP;
+        if (oldheight < current_video_height)
+        {
+            const double budget = DRS_AIM * target - drs.fixed_time;
+            const double scale =
+                BETWEEN(1.0, DRS_MAX_GROWTH,
+                        sqrt(MAX(budget, 0.0) / predicted_pixel_time));
+            newheight = QuantizeHeight(oldheight * scale);
 
-    if (newheight > current_video_height)
+            if (newheight <= oldheight)
+            {
+                newheight = QuantizeHeight(oldheight + DRS_STEP);
+            }
+        }
+        else if (reduced_sprite_detail)
+        {
+            reduced_sprite_detail = false;
+            drs.cooldown = targetrefresh / 4;
+            return;
+        }
+        else if (drs.voxels_reduced)
+        {
+            VX_IncreaseMaxDist();
+            drs.voxels_reduced = false;
+            drs.cooldown = targetrefresh / 4;
+            return;
+        }
+        else
+        {
+            return;
+        }
+    }
+    else
     {
-        newheight = current_video_height;
+        drs.low_frames = 0;
+        return;
     }
 
     if (newheight == oldheight)
@@ -770,14 +994,10 @@ void I_DynamicResolution(void)
         return;
     }
 
-    if (newheight < oldheight)
-    {
-        VX_DecreaseMaxDist();
-    }
-    else
-    {
-        VX_IncreaseMaxDist();
-    }
+    // Keep the pixel-bound average consistent with the new resolution
+    const double ratio = (double)newheight / oldheight;
+    drs.pixel_time *= ratio * ratio;
+    drs.cooldown = targetrefresh / 4;
 
     ResetResolution(newheight, false);
     ResetLogicalSize();
@@ -789,8 +1009,134 @@ static unsigned int disk_to_draw, disk_to_restore;
 static void CreateUpscaledTexture(boolean force);
 static void I_ResetTargetRefresh(void);
 
+// [Nugget] /-----------------------------------------------------------------
+
+// Screenshots are read back on the main thread, and then encoded and
+// written by the thread pool. They are reported in the order they were
+// taken, once finished.
+
+#define MAX_PENDING_SCREENSHOTS 4
+
+typedef struct
+{
+    char *filename;
+    byte *pixels;
+    int width, height;
+    boolean success;
+    int error;
+    int encode_error; // From spng, reported on the main thread
+    boolean done;
+} screenshot_t;
+
+static screenshot_t *screenshots[MAX_PENDING_SCREENSHOTS];
+static int num_screenshots;
+
+static void EncodeScreenshot(void *data)
+{
+    screenshot_t *shot = data;
+    const int pitch = shot->width * 3;
+    const int size = shot->height * pitch;
+
+    errno = 0;
+
+    FILE *file = M_fopen(shot->filename, "wb");
+    if (!file)
+    {
+        shot->error = errno;
+        free(shot->pixels);
+        return;
+    }
+
+    spng_ctx *ctx = spng_ctx_new(SPNG_CTX_ENCODER);
+    spng_set_png_file(ctx, file);
+    spng_set_option(ctx, SPNG_IMG_COMPRESSION_LEVEL, 1);
+
+    struct spng_ihdr ihdr = {0};
+    ihdr.width = shot->width;
+    ihdr.height = shot->height;
+    ihdr.color_type = SPNG_COLOR_TYPE_TRUECOLOR;
+    ihdr.bit_depth = 8;
+    spng_set_ihdr(ctx, &ihdr);
+
+    int ret = spng_encode_image(ctx, shot->pixels, size, SPNG_FMT_PNG,
+                                SPNG_ENCODE_FINALIZE);
+    shot->encode_error = ret;
+
+    shot->success = (fclose(file) == 0) && !ret;
+    shot->error = shot->success ? 0 : errno;
+
+    spng_ctx_free(ctx);
+    free(shot->pixels);
+}
+
+// Reports the oldest screenshot, waiting for it if needed
+static boolean FinishScreenshot(boolean wait, boolean report)
+{
+    screenshot_t *shot = screenshots[0];
+
+    if (!num_screenshots || (!wait && !I_JobDone(&shot->done)))
+    {
+        return false;
+    }
+
+    I_WaitForJob(&shot->done);
+
+    // Printing isn't thread-safe, so the worker left it to this thread
+    if (shot->encode_error)
+    {
+        I_Printf(VB_ERROR, "spng_encode_image() error: %s\n",
+                 spng_strerror(shot->encode_error));
+    }
+    else if (shot->success)
+    {
+        I_Printf(VB_INFO, "I_WritePNGfile: %s", shot->filename);
+    }
+
+    if (report)
+    {
+        V_ScreenShotDone(shot->filename, shot->success, shot->error);
+    }
+    else if (!shot->success)
+    {
+        M_remove(shot->filename);
+    }
+
+    free(shot->filename);
+    free(shot);
+
+    num_screenshots--;
+    memmove(screenshots, screenshots + 1,
+            num_screenshots * sizeof(*screenshots));
+
+    return true;
+}
+
+static void UpdateScreenshots(void)
+{
+    while (FinishScreenshot(false, true))
+    {
+        ;
+    }
+}
+
+static void WaitForScreenshots(void)
+{
+    while (FinishScreenshot(true, false))
+    {
+        ;
+    }
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 void I_FinishUpdate(void)
 {
+    // [Nugget] Before anything is drawn over the frame
+    I_CaptureFrame(screenbuffer->pixels, screenbuffer->pitch, blit_rect.w,
+                   blit_rect.h, argb_palette);
+
+    UpdateScreenshots(); // [Nugget]
+
     if (NOBLIT)
     {
         return;
@@ -832,14 +1178,20 @@ void I_FinishUpdate(void)
 
     I_DrawDiskIcon();
 
+    M_PerfStart(PERF_UPLOAD); // [Nugget]
     UpdateRender();
+    M_PerfStop(PERF_UPLOAD); // [Nugget]
 
     if (frametime_start)
     {
         frametime_withoutpresent = I_GetTimeUS() - frametime_start;
     }
 
+    M_PerfStart(PERF_PRESENT); // [Nugget]
     SDL_RenderPresent(renderer);
+    M_PerfStop(PERF_PRESENT); // [Nugget]
+
+    M_PerfFrameDone(); // [Nugget]
 
     I_RestoreDiskBackground();
 
@@ -1032,10 +1384,7 @@ void I_SetPalette(byte *palette)
     const byte *const gamma = gammatable[gamma2];
     SDL_Color colors[256];
 
-    if (noblit) // killough 8/11/98
-    {
-        return;
-    }
+    // [Nugget] The palette is still built under -noblit, for -capture
 
     for (i = 0; i < 256; ++i)
     {
@@ -1060,9 +1409,19 @@ void I_SetPalette(byte *palette)
         colors[i].b = (a_lo * r) + (a_lo * g) + (a_hi * b);
 
         colors[i].a = 0xffu;
+
+        // [Nugget]
+        argb_palette[i] = 0xff000000u | (colors[i].r << 16)
+                          | (colors[i].g << 8) | colors[i].b;
+    }
+
+    if (noblit) // killough 8/11/98
+    {
+        return;
     }
 
     SDL_SetPaletteColors(screenbuffer->format->palette, colors, 0, 256);
+    full_upload = true; // [Nugget]
 
     if (vga_porch_flash)
     {
@@ -1133,51 +1492,37 @@ boolean I_WritePNGfile(char *filename)
         }
     }
 
+    // [Nugget] Bound the memory held by pending screenshots
+    if (num_screenshots == MAX_PENDING_SCREENSHOTS)
+    {
+        FinishScreenshot(true, true);
+    }
+
     // [FG] allocate memory for screenshot image
     int pitch = rect.w * 3;
     int size = rect.h * pitch;
     byte *pixels = malloc(size);
 
-    SDL_RenderReadPixels(renderer, &rect, SDL_PIXELFORMAT_RGB24, pixels, pitch);
-
-    FILE *file = M_fopen(filename, "wb");
-    if (!file)
+    if (!pixels)
     {
-        free(pixels);
         return false;
     }
 
-    spng_ctx *ctx = spng_ctx_new(SPNG_CTX_ENCODER);
-    spng_set_png_file(ctx, file);
-    spng_set_option(ctx, SPNG_IMG_COMPRESSION_LEVEL, 1);
-
-    struct spng_ihdr ihdr = {0};
-    ihdr.width = rect.w;
-    ihdr.height = rect.h;
-    ihdr.color_type = SPNG_COLOR_TYPE_TRUECOLOR;
-    ihdr.bit_depth = 8;
-    spng_set_ihdr(ctx, &ihdr);
-
-    int ret = spng_encode_image(ctx, pixels, size, SPNG_FMT_PNG,
-                                SPNG_ENCODE_FINALIZE);
-    if (ret)
-    {
-        I_Printf(VB_ERROR, "spng_encode_image() error: %s\n",
-                 spng_strerror(ret));
-    }
-    else
-    {
-        I_Printf(VB_INFO, "I_WritePNGfile: %s", filename);
-    }
+    SDL_RenderReadPixels(renderer, &rect, SDL_PIXELFORMAT_RGB24, pixels, pitch);
 
-    fclose(file);
+    // [Nugget] Encode and write it in the background
+    screenshot_t *shot = calloc(1, sizeof(*shot));
+    shot->filename = M_StringDuplicate(filename);
+    shot->pixels = pixels;
+    shot->width = rect.w;
+    shot->height = rect.h;
 
-    spng_ctx_free(ctx);
-    free(pixels);
+    screenshots[num_screenshots++] = shot;
+    I_QueueJob(EncodeScreenshot, shot, &shot->done);
 
     drs_skip_frame = true;
 
-    return !ret;
+    return true;
 }
 
 // Set the application icon
@@ -1464,6 +1809,7 @@ static void ResetLogicalSize(void)
 {
     blit_rect.w = video.width;
     blit_rect.h = video.height;
+    full_upload = true; // [Nugget]
 
     // [Nugget] /-------------------------------------------------------------
 
@@ -1840,15 +2186,10 @@ static void CreateSurfaces(int w, int h)
     I_VideoBuffer = screenbuffer->pixels;
     V_RestoreBuffer();
 
-    if (argbbuffer != NULL)
-    {
-        SDL_FreeSurface(argbbuffer);
-    }
-
-    // [FG] create intermediate ARGB frame buffer
+    // [Nugget] Copy of the last uploaded frame
 
-    argbbuffer = SDL_CreateRGBSurfaceWithFormatFrom(
-        NULL, w, h, 0, 0, SDL_PIXELFORMAT_ARGB8888);
+    last_frame = I_Realloc(last_frame, (size_t)screenbuffer->pitch * h);
+    full_upload = true;
 
     I_SetPalette(W_CacheLumpName("PLAYPAL", PU_CACHE));
 
@@ -1912,6 +2253,8 @@ void I_ResetScreen(void)
 
     widescreen = default_widescreen;
 
+    ResetDRS(); // [Nugget]
+
     ResetResolution(GetCurrentVideoHeight(), true);
     CreateSurfaces(video.pitch, video.height);
     ResetLogicalSize();
@@ -1919,6 +2262,8 @@ void I_ResetScreen(void)
 
 void I_ShutdownGraphics(void)
 {
+    WaitForScreenshots(); // [Nugget]
+
     if (!(fullscreen && exclusive_fullscreen))
     {
         SDL_GetWindowPosition(screen, &window_position_x, &window_position_y);
@@ -1944,6 +2289,7 @@ void I_InitGraphics(void)
     I_AtExit(I_ShutdownGraphics, true);
 
     I_InitVideoParms();
+    I_InitPaletteConversion(); // [Nugget]
     I_InitGraphicsMode(); // killough 10/98
     ResetResolution(GetCurrentVideoHeight(), true);
     CreateSurfaces(video.pitch, video.height);
@@ -1963,6 +2309,11 @@ void I_BindVideoVariables(void)
               "Vertical resolution");
     BIND_BOOL_GENERAL(dynamic_resolution, true, "Dynamic resolution");
 
+    // [Nugget] (CFG-only)
+    BIND_BOOL(dynamic_sprite_detail, false,
+        "Dynamic resolution may draw far translucent sprites as opaque "
+        "under heavy load");
+
     // [Nugget] (CFG-only)
     M_BindStr("sdl_renderdriver", &sdl_renderdriver, "", wad_no,
         "SDL render driver, possible values are "
@@ -2021,6 +2372,10 @@ void I_BindVideoVariables(void)
     BIND_NUM(blue_intensity,  100, 0, 100, "Intensity percent of the screen's blue component");
 
     BIND_NUM(color_saturation, 100, 0, 100, "Saturation percent of the screen's colors");
+
+    // [Nugget] (CFG-only)
+    BIND_BOOL(dirty_row_upload, true,
+        "Only upload the rows of menu and intermission frames that changed");
 }
 
 //----------------------------------------------------------------------------
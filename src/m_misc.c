@@ -609,3 +609,16 @@ boolean M_StringToDigest(const char *string, byte *digest, int size)
     }
     return true;
 }
+
+// [Nugget]
+uint64_t M_HashData(const byte *data, size_t len)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
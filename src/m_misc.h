@@ -60,4 +60,7 @@ boolean M_WriteFile(const char *name, void *source, int length);
 int M_ReadFile(const char *name, byte **buffer);
 boolean M_StringToDigest(const char *string, byte *digest, int size);
 
+// [Nugget] 64-bit FNV-1a, for identifying data by its contents
+uint64_t M_HashData(const byte *data, size_t len);
+
 #endif
@@ -0,0 +1,223 @@
+//
+//  Copyright(C) 2024 Alaux
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Frame-time breakdown of the render pipeline
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "i_printf.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "i_video.h"
+#include "m_argv.h"
+#include "m_io.h"
+#include "m_perf.h"
+#include "r_main.h"
+
+boolean hud_frame_timings;
+
+int perf_last[NUMPERFSTAGES];
+
+// Rolling window of frames that the histograms cover
+#define PERF_WINDOW 256
+
+// Linear histogram buckets; anything slower lands in the last one
+#define PERF_BUCKET_US 20
+#define PERF_BUCKETS   1024
+
+static const char *stage_names[NUMPERFSTAGES] = {
+    "Setup", "BSP", "Planes", "Masked", "HUD", "Upload", "Present", "Frame"
+};
+
+static uint64_t stage_start[NUMPERFSTAGES];
+static uint64_t stage_time[NUMPERFSTAGES];
+
+static uint16_t window[NUMPERFSTAGES][PERF_WINDOW];
+static uint16_t histogram[NUMPERFSTAGES][PERF_BUCKETS];
+static int window_pos, window_count;
+
+static uint64_t frame_start;
+static unsigned int frame_number;
+
+static FILE *csv_file;
+
+boolean M_PerfActive(void)
+{
+    // The dynamic resolution controller is driven by the stage timings
+    return hud_frame_timings || csv_file || dynamic_resolution;
+}
+
+void M_PerfStart(perfstage_t stage)
+{
+    if (!M_PerfActive())
+    {
+        return;
+    }
+
+    stage_start[stage] = I_GetTimeUS();
+}
+
+void M_PerfStop(perfstage_t stage)
+{
+    if (!M_PerfActive() || !stage_start[stage])
+    {
+        return;
+    }
+
+    // Stages may run more than once per frame (e.g. intermission
+    // backgrounds), so accumulate
+    stage_time[stage] += I_GetTimeUS() - stage_start[stage];
+    stage_start[stage] = 0;
+}
+
+static int TimeToBucket(uint64_t time)
+{
+    const uint64_t bucket = time / PERF_BUCKET_US;
+    return bucket < PERF_BUCKETS ? (int)bucket : PERF_BUCKETS - 1;
+}
+
+void M_PerfFrameDone(void)
+{
+    if (!M_PerfActive())
+    {
+        frame_start = 0;
+        return;
+    }
+
+    const uint64_t now = I_GetTimeUS();
+
+    if (frame_start)
+    {
+        stage_time[PERF_FRAME] = now - frame_start;
+    }
+
+    frame_start = now;
+
+    for (int i = 0; i < NUMPERFSTAGES; i++)
+    {
+        const int bucket = TimeToBucket(stage_time[i]);
+
+        if (window_count == PERF_WINDOW)
+        {
+            histogram[i][window[i][window_pos]]--;
+        }
+
+        window[i][window_pos] = bucket;
+        histogram[i][bucket]++;
+
+        perf_last[i] = (int)stage_time[i];
+        stage_time[i] = 0;
+    }
+
+    window_pos = (window_pos + 1) % PERF_WINDOW;
+
+    if (window_count < PERF_WINDOW)
+    {
+        window_count++;
+    }
+
+    if (csv_file)
+    {
+        fprintf(csv_file, "%u", frame_number);
+
+        for (int i = 0; i < NUMPERFSTAGES; i++)
+        {
+            fprintf(csv_file, ",%d", perf_last[i]);
+        }
+
+        fprintf(csv_file, ",%d,%d,%d,%d\n", rendered_segs, rendered_visplanes,
+                rendered_vissprites, rendered_voxels);
+    }
+
+    frame_number++;
+}
+
+int M_PerfPercentile(perfstage_t stage, int percent)
+{
+    if (!window_count)
+    {
+        return 0;
+    }
+
+    const int target = (window_count * percent + 99) / 100;
+    int sum = 0;
+
+    for (int i = 0; i < PERF_BUCKETS; i++)
+    {
+        sum += histogram[stage][i];
+
+        if (sum >= target)
+        {
+            // Report the upper bound of the bucket
+            return (i + 1) * PERF_BUCKET_US;
+        }
+    }
+
+    return PERF_BUCKETS * PERF_BUCKET_US;
+}
+
+const char *M_PerfStageName(perfstage_t stage)
+{
+    return stage_names[stage];
+}
+
+static void ClosePerfCSV(void)
+{
+    if (csv_file)
+    {
+        fclose(csv_file);
+        csv_file = NULL;
+    }
+}
+
+void M_InitPerf(void)
+{
+    //!
+    // @arg <file>
+    // @category video
+    //
+    // Write per-frame render pipeline timings (in microseconds) to the given
+    // CSV file.
+    //
+
+    int p = M_CheckParmWithArgs("-perfcsv", 1);
+
+    if (!p)
+    {
+        return;
+    }
+
+    csv_file = M_fopen(myargv[p + 1], "w");
+
+    if (!csv_file)
+    {
+        I_Printf(VB_WARNING, "M_InitPerf: Failed to open %s", myargv[p + 1]);
+        return;
+    }
+
+    fprintf(csv_file, "frame");
+
+    for (int i = 0; i < NUMPERFSTAGES; i++)
+    {
+        fprintf(csv_file, ",%s", stage_names[i]);
+    }
+
+    fprintf(csv_file, ",segs,visplanes,vissprites,voxels\n");
+
+    I_AtExit(ClosePerfCSV, true);
+
+    I_Printf(VB_INFO, "M_InitPerf: Writing frame timings to %s", myargv[p + 1]);
+}
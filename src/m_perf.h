@@ -0,0 +1,59 @@
+//
+//  Copyright(C) 2024 Alaux
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Frame-time breakdown of the render pipeline
+//
+
+#ifndef __M_PERF__
+#define __M_PERF__
+
+#include "doomtype.h"
+
+typedef enum
+{
+    PERF_SETUPFRAME, // R_SetupFrame()
+    PERF_BSP,        // R_RenderBSPNode()
+    PERF_PLANES,     // R_DrawPlanes()
+    PERF_MASKED,     // R_DrawMasked()
+    PERF_HUD,        // ST_Drawer(), AM_Drawer()
+    PERF_UPLOAD,     // Palette conversion and texture upload
+    PERF_PRESENT,    // SDL_RenderPresent()
+    PERF_FRAME,      // Whole frame, including frame limiter
+
+    NUMPERFSTAGES
+} perfstage_t;
+
+extern boolean hud_frame_timings;
+
+// Time spent in each stage during the last completed frame, in microseconds
+extern int perf_last[NUMPERFSTAGES];
+
+boolean M_PerfActive(void);
+
+void M_PerfStart(perfstage_t stage);
+void M_PerfStop(perfstage_t stage);
+
+// Called once per presented frame, pushes the stage times into the
+// rolling histograms and the CSV dump
+void M_PerfFrameDone(void);
+
+// Percentile (0-100) of the given stage over the last PERF_WINDOW frames,
+// in microseconds
+int M_PerfPercentile(perfstage_t stage, int percent);
+
+const char *M_PerfStageName(perfstage_t stage);
+
+void M_InitPerf(void);
+
+#endif
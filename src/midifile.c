@@ -20,6 +20,8 @@
 
 #include "SDL_endian.h"
 
+#include <limits.h>
+
 #include "doomtype.h"
 #include "i_printf.h"
 #include "memio.h"
@@ -85,6 +87,10 @@ struct midi_file_s
 
     // Number of EMIDI events, without track exclusion.
     unsigned int num_emidi_events;
+
+    // [Nugget] Events of all tracks, merged and sorted by time.
+    midi_flat_event_t *flat_events;
+    unsigned int num_flat_events;
 };
 
 // Check the header of a chunk:
@@ -638,9 +644,99 @@ void MIDI_FreeFile(midi_file_t *file)
         free(file->tracks);
     }
 
+    free(file->flat_events); // [Nugget]
     free(file);
 }
 
+// [Nugget] Merge all tracks into a single time-sorted array. Events with the
+// same time keep the order in which the sequencers used to merge them: by
+// track, then by position within the track.
+
+static boolean FlattenTracks(midi_file_t *file)
+{
+    const unsigned int division = MIDI_GetFileTimeDivision(file);
+    unsigned int *positions, *track_times;
+    unsigned int num_events = 0;
+
+    // Tempo in effect, and the time at which it was set
+    unsigned int tempo = MIDI_DEFAULT_TEMPO;
+    unsigned int tempo_ticks = 0;
+    uint64_t tempo_us = 0;
+
+    for (unsigned int i = 0; i < file->num_tracks; ++i)
+    {
+        num_events += file->tracks[i].num_events;
+    }
+
+    file->flat_events = malloc(MAX(num_events, 1) * sizeof(midi_flat_event_t));
+    positions = calloc(file->num_tracks, sizeof(*positions));
+    track_times = calloc(file->num_tracks, sizeof(*track_times));
+
+    if (file->flat_events == NULL || positions == NULL || track_times == NULL)
+    {
+        free(file->flat_events);
+        file->flat_events = NULL;
+        free(positions);
+        free(track_times);
+        return false;
+    }
+
+    while (file->num_flat_events < num_events)
+    {
+        unsigned int min_time = UINT_MAX;
+        unsigned int track = 0;
+
+        for (unsigned int i = 0; i < file->num_tracks; ++i)
+        {
+            const midi_track_t *t = &file->tracks[i];
+
+            if (positions[i] < t->num_events)
+            {
+                const unsigned int time =
+                    track_times[i] + t->events[positions[i]].delta_time;
+
+                if (time < min_time)
+                {
+                    min_time = time;
+                    track = i;
+                }
+            }
+        }
+
+        midi_event_t *event = &file->tracks[track].events[positions[track]++];
+        midi_flat_event_t *flat = &file->flat_events[file->num_flat_events++];
+
+        track_times[track] = min_time;
+
+        flat->ticks = min_time;
+        flat->time_us = tempo_us;
+        flat->track = track;
+        flat->event = event;
+
+        if (division)
+        {
+            flat->time_us +=
+                (uint64_t)(min_time - tempo_ticks) * tempo / division;
+        }
+
+        if (event->event_type == MIDI_EVENT_META
+            && event->data.meta.type == MIDI_META_SET_TEMPO
+            && event->data.meta.length == 3)
+        {
+            const byte *data = event->data.meta.data;
+
+            tempo = (data[0] << 16) | (data[1] << 8) | data[2];
+            tempo_ticks = min_time;
+            tempo_us = flat->time_us;
+        }
+    }
+
+    free(positions);
+    free(track_times);
+
+    return true;
+}
+
 midi_file_t *MIDI_LoadFile(void *buf, size_t buflen)
 {
     midi_file_t *file;
@@ -657,6 +753,8 @@ midi_file_t *MIDI_LoadFile(void *buf, size_t buflen)
     file->num_tracks = 0;
     file->num_rpg_events = 0;
     file->num_emidi_events = 0;
+    file->flat_events = NULL; // [Nugget]
+    file->num_flat_events = 0; // [Nugget]
 
     // Open file
 
@@ -790,6 +888,23 @@ boolean MIDI_RPGLoop(const midi_file_t *file)
     return (file->num_rpg_events == 1 && file->num_emidi_events == 0);
 }
 
+// [Nugget] /-----------------------------------------------------------------
+
+const midi_flat_event_t *MIDI_GetFlatEvents(midi_file_t *file,
+                                            unsigned int *num_events)
+{
+    if (file->flat_events == NULL && !FlattenTracks(file))
+    {
+        *num_events = 0;
+        return NULL;
+    }
+
+    *num_events = file->num_flat_events;
+    return file->flat_events;
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 static boolean RolandChecksum(const byte *data)
 {
     const byte checksum =
@@ -202,6 +202,23 @@ typedef struct
     } data;
 } midi_event_t;
 
+// [Nugget] An event of the flattened, time-sorted stream of all tracks
+
+typedef struct
+{
+    // Absolute time of the event, in ticks and in microseconds with all
+    // preceding tempo changes applied:
+
+    unsigned int ticks;
+    uint64_t time_us;
+
+    // Track that the event belongs to:
+
+    unsigned int track;
+
+    midi_event_t *event;
+} midi_flat_event_t;
+
 // Load a MIDI file.
 
 midi_file_t *MIDI_LoadFile(void *buf, size_t buflen);
@@ -250,4 +267,10 @@ void MIDI_RestartAtLoopPoint(midi_track_iter_t *iter);
 
 boolean MIDI_RPGLoop(const midi_file_t *file);
 
+// [Nugget] Get the events of all tracks merged into a single array, sorted
+// by time. Built on the first call; returns NULL if that fails.
+
+const midi_flat_event_t *MIDI_GetFlatEvents(midi_file_t *file,
+                                            unsigned int *num_events);
+
 #endif /* #ifndef MIDIFILE_H */
@@ -69,6 +69,7 @@
 #include "am_map.h"
 #include "hu_crosshair.h"
 #include "m_nughud.h"
+#include "mn_saveindex.h"
 #include "st_stuff.h"
 
 // [crispy] remove DOS reference from the game quit confirmation dialogs
@@ -1265,14 +1266,28 @@ static void EmptySaveString(char *name, boolean is_autosave)
 static void M_ReadSaveString(char *name, int menu_slot, int save_slot,
                              boolean is_autosave)
 {
-    FILE *fp = M_fopen(name, "rb");
+    FILE *fp;
+    byte *thumbnail;
+
     MN_ReadSavegameTime(menu_slot, name);
-    free(name);
+
+    // [Nugget] Try the index first, which saves opening the savegame
+    if (MN_LookupSaveIndex(name, savegamestrings[menu_slot], &thumbnail))
+    {
+        free(name);
+        MN_SetSnapshot(menu_slot, thumbnail);
+        SetLoadSlotStatus(menu_slot, 1);
+        return;
+    }
+
+    fp = M_fopen(name, "rb");
 
     MN_ResetSnapshot(menu_slot);
 
     if (!fp)
     {
+        free(name);
+
         if (!is_autosave)
         {
             // Ty 03/27/98 - externalized:
@@ -1287,12 +1302,15 @@ static void M_ReadSaveString(char *name, int menu_slot, int save_slot,
             SetLoadSlotStatus(menu_slot, 0);
             return;
         }
+
+        name = NULL;
     }
 
     // [FG] check return value
     if (!fread(&savegamestrings[menu_slot], SAVESTRINGSIZE, 1, fp))
     {
         fclose(fp);
+        free(name);
         EmptySaveString(savegamestrings[menu_slot], is_autosave);
         SetLoadSlotStatus(menu_slot, 0);
         return;
@@ -1305,6 +1323,37 @@ static void M_ReadSaveString(char *name, int menu_slot, int save_slot,
 
     fclose(fp);
     SetLoadSlotStatus(menu_slot, 1);
+
+    // [Nugget] Savegames from before the index, or from elsewhere
+    if (name)
+    {
+        MN_UpdateSaveIndex(name, savegamestrings[menu_slot],
+                           MN_GetSnapshot(menu_slot));
+        free(name);
+    }
+}
+
+// [Nugget] Load the thumbnails of the neighbouring pages in the background
+static void PrefetchSavePages(void)
+{
+    char *names[3 * 10];
+    int count = 0;
+
+    for (int page = MAX(0, savepage - 1);
+         page <= MIN(savepage_max, savepage + 1); page++)
+    {
+        for (int slot = 0; slot < 10; slot++)
+        {
+            names[count++] = G_PageSaveGameName(page, slot);
+        }
+    }
+
+    MN_PrefetchSaveIndex(names, count);
+
+    for (int i = 0; i < count; i++)
+    {
+        free(names[i]);
+    }
 }
 
 static void UpdateRectX(menu_t *menu, int x)
@@ -1352,6 +1401,8 @@ static void M_ReadSaveStrings(void)
         char *name = G_SaveGameName(save_slot);
         M_ReadSaveString(name, menu_slot, save_slot, false);
     }
+
+    PrefetchSavePages(); // [Nugget]
 }
 
 //
@@ -0,0 +1,478 @@
+//
+//  Copyright(C) 2024 Alaux
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Index of savegame descriptions and thumbnails
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "SDL.h"
+
+#include "d_main.h"
+#include "doomdef.h"
+#include "i_printf.h"
+#include "i_system.h"
+#include "i_thread.h"
+#include "m_array.h"
+#include "m_io.h"
+#include "m_misc.h"
+#include "mn_saveindex.h"
+
+// The index lives next to the savegames, so the load and save menus don't
+// have to open every one of them. File layout, all little-endian: magic,
+// thumbnail size, and then one fixed-size record per savegame, so that a
+// record can be rewritten in place when its savegame is.
+#define INDEX_FILENAME "saveindex.bin"
+#define INDEX_MAGIC    "NUGSIX01" // Bump along with the record layout
+#define MAGIC_LEN      8
+#define HEADER_LEN     (MAGIC_LEN + 4)
+
+#define NAME_LEN          32
+#define RECORD_HEADER_LEN (NAME_LEN + 8 + 8 + SAVEINDEX_DESCRIPTION_LEN + 4)
+#define THUMBNAIL_SIZE    (SCREENWIDTH * SCREENHEIGHT)
+#define RECORD_LEN        (RECORD_HEADER_LEN + THUMBNAIL_SIZE)
+
+// The current page and its two neighbours
+#define MAX_PREFETCH 32
+
+typedef struct
+{
+    char name[NAME_LEN]; // Base name of the savegame, in lowercase
+    int64_t mtime, size; // Of the savegame, when it was indexed
+    char description[SAVEINDEX_DESCRIPTION_LEN];
+    boolean has_thumbnail;
+
+    byte *thumbnail; // Loaded from the file, or NULL
+    boolean wanted;  // By the last prefetch
+} saveindex_entry_t;
+
+// Entries are in the same order as the records in the file
+static saveindex_entry_t *entries;
+
+static FILE *index_file;
+static char *index_dir;
+static SDL_mutex *index_lock;
+
+static char prefetch_names[MAX_PREFETCH][NAME_LEN];
+static int prefetch_count;
+static boolean prefetch_done = true;
+
+static uint32_t GetU32(const byte *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void PutU32(byte *p, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        p[i] = (value >> (i * 8)) & 0xff;
+    }
+}
+
+static long RecordOffset(int i)
+{
+    return HEADER_LEN + (long)i * RECORD_LEN;
+}
+
+static void KeyName(char *name, const char *path)
+{
+    M_StringCopy(name, M_BaseName(path), NAME_LEN);
+    M_StringToLower(name);
+}
+
+static boolean StatSavegame(const char *path, int64_t *mtime, int64_t *size)
+{
+    struct stat st;
+
+    if (M_stat(path, &st) == -1)
+    {
+        return false;
+    }
+
+    *mtime = st.st_mtime;
+    *size = st.st_size;
+
+    return true;
+}
+
+// Must be called with the lock held
+static void CloseIndexFile(void)
+{
+    if (index_file)
+    {
+        fclose(index_file);
+        index_file = NULL;
+    }
+
+    for (int i = 0; i < array_size(entries); i++)
+    {
+        free(entries[i].thumbnail);
+    }
+
+    array_clear(entries);
+}
+
+// Must be called with the lock held
+static void OpenIndexFile(void)
+{
+    char *path = M_StringJoin(index_dir, DIR_SEPARATOR_S, INDEX_FILENAME);
+    byte header[HEADER_LEN];
+
+    index_file = M_fopen(path, "r+b");
+
+    if (!index_file || fread(header, sizeof(header), 1, index_file) != 1
+        || memcmp(header, INDEX_MAGIC, MAGIC_LEN)
+        || GetU32(header + MAGIC_LEN) != THUMBNAIL_SIZE)
+    {
+        // Missing or outdated, so start over
+        if (index_file)
+        {
+            fclose(index_file);
+        }
+
+        index_file = M_fopen(path, "w+b");
+
+        if (index_file)
+        {
+            memcpy(header, INDEX_MAGIC, MAGIC_LEN);
+            PutU32(header + MAGIC_LEN, THUMBNAIL_SIZE);
+            fwrite(header, sizeof(header), 1, index_file);
+            fflush(index_file);
+        }
+        else
+        {
+            I_Printf(VB_WARNING, "OpenIndexFile: Failed to open %s", path);
+        }
+
+        free(path);
+        return;
+    }
+
+    free(path);
+
+    // A truncated record ends the index; it is overwritten by the next one
+    for (int i = 0;; i++)
+    {
+        byte raw[RECORD_HEADER_LEN];
+        saveindex_entry_t entry = {0};
+
+        if (fseek(index_file, RecordOffset(i), SEEK_SET)
+            || fread(raw, sizeof(raw), 1, index_file) != 1)
+        {
+            break;
+        }
+
+        memcpy(entry.name, raw, NAME_LEN);
+        entry.name[NAME_LEN - 1] = '\0';
+        entry.mtime = GetU32(raw + NAME_LEN)
+                      | ((int64_t)GetU32(raw + NAME_LEN + 4) << 32);
+        entry.size = GetU32(raw + NAME_LEN + 8)
+                     | ((int64_t)GetU32(raw + NAME_LEN + 12) << 32);
+        memcpy(entry.description, raw + NAME_LEN + 16,
+               SAVEINDEX_DESCRIPTION_LEN);
+        entry.has_thumbnail =
+            GetU32(raw + NAME_LEN + 16 + SAVEINDEX_DESCRIPTION_LEN) != 0;
+
+        array_push(entries, entry);
+    }
+
+    I_Printf(VB_DEBUG, "OpenIndexFile: %d indexed savegames",
+             array_size(entries));
+}
+
+static void ShutdownSaveIndex(void)
+{
+    I_WaitForJob(&prefetch_done);
+
+    SDL_LockMutex(index_lock);
+    CloseIndexFile();
+    SDL_UnlockMutex(index_lock);
+}
+
+// Locks the index on success, which follows the savegame directory
+static boolean LockIndex(void)
+{
+    if (!index_lock)
+    {
+        index_lock = SDL_CreateMutex();
+
+        if (!index_lock)
+        {
+            I_Printf(VB_WARNING, "LockIndex: %s", SDL_GetError());
+            return false;
+        }
+
+        I_AtExit(ShutdownSaveIndex, false);
+    }
+
+    SDL_LockMutex(index_lock);
+
+    if (!index_dir || strcmp(index_dir, basesavegame))
+    {
+        CloseIndexFile();
+        free(index_dir);
+        index_dir = M_StringDuplicate(basesavegame);
+        OpenIndexFile();
+    }
+
+    if (!index_file)
+    {
+        SDL_UnlockMutex(index_lock);
+        return false;
+    }
+
+    return true;
+}
+
+// Must be called with the lock held
+static int FindEntry(const char *name)
+{
+    for (int i = 0; i < array_size(entries); i++)
+    {
+        if (!strcmp(entries[i].name, name))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Must be called with the lock held
+static void LoadThumbnail(int i)
+{
+    saveindex_entry_t *entry = &entries[i];
+
+    if (!entry->has_thumbnail || entry->thumbnail)
+    {
+        return;
+    }
+
+    entry->thumbnail = malloc(THUMBNAIL_SIZE);
+
+    if (fseek(index_file, RecordOffset(i) + RECORD_HEADER_LEN, SEEK_SET)
+        || fread(entry->thumbnail, THUMBNAIL_SIZE, 1, index_file) != 1)
+    {
+        free(entry->thumbnail);
+        entry->thumbnail = NULL;
+        entry->has_thumbnail = false;
+    }
+}
+
+// Must be called with the lock held
+static boolean WriteRecord(int i)
+{
+    const saveindex_entry_t *entry = &entries[i];
+    byte raw[RECORD_HEADER_LEN] = {0};
+
+    memcpy(raw, entry->name, NAME_LEN);
+    PutU32(raw + NAME_LEN, entry->mtime & 0xffffffff);
+    PutU32(raw + NAME_LEN + 4, (uint64_t)entry->mtime >> 32);
+    PutU32(raw + NAME_LEN + 8, entry->size & 0xffffffff);
+    PutU32(raw + NAME_LEN + 12, (uint64_t)entry->size >> 32);
+    memcpy(raw + NAME_LEN + 16, entry->description, SAVEINDEX_DESCRIPTION_LEN);
+    PutU32(raw + NAME_LEN + 16 + SAVEINDEX_DESCRIPTION_LEN,
+           entry->has_thumbnail);
+
+    if (fseek(index_file, RecordOffset(i), SEEK_SET)
+        || fwrite(raw, sizeof(raw), 1, index_file) != 1)
+    {
+        return false;
+    }
+
+    // The thumbnail area is written even without a thumbnail, so that the
+    // next record starts where expected
+    if (entry->has_thumbnail)
+    {
+        if (fwrite(entry->thumbnail, THUMBNAIL_SIZE, 1, index_file) != 1)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        static const byte blank[THUMBNAIL_SIZE];
+
+        if (fwrite(blank, THUMBNAIL_SIZE, 1, index_file) != 1)
+        {
+            return false;
+        }
+    }
+
+    return fflush(index_file) == 0;
+}
+
+boolean MN_LookupSaveIndex(const char *path, char *description,
+                           byte **thumbnail)
+{
+    char name[NAME_LEN];
+    int64_t mtime, size;
+    boolean result = false;
+    int i;
+
+    *thumbnail = NULL;
+
+    if (!StatSavegame(path, &mtime, &size) || !LockIndex())
+    {
+        return false;
+    }
+
+    KeyName(name, path);
+
+    if ((i = FindEntry(name)) >= 0 && entries[i].mtime == mtime
+        && entries[i].size == size)
+    {
+        LoadThumbnail(i);
+
+        memcpy(description, entries[i].description, SAVEINDEX_DESCRIPTION_LEN);
+
+        if (entries[i].thumbnail)
+        {
+            *thumbnail = malloc(THUMBNAIL_SIZE);
+            memcpy(*thumbnail, entries[i].thumbnail, THUMBNAIL_SIZE);
+        }
+
+        result = true;
+    }
+
+    SDL_UnlockMutex(index_lock);
+
+    return result;
+}
+
+void MN_UpdateSaveIndex(const char *path, const char *description,
+                        const byte *thumbnail)
+{
+    saveindex_entry_t *entry;
+    int64_t mtime, size;
+    char name[NAME_LEN];
+    int i;
+
+    if (!StatSavegame(path, &mtime, &size) || !LockIndex())
+    {
+        return;
+    }
+
+    KeyName(name, path);
+
+    if ((i = FindEntry(name)) < 0)
+    {
+        const saveindex_entry_t new_entry = {0};
+
+        array_push(entries, new_entry);
+        i = array_size(entries) - 1;
+        memcpy(entries[i].name, name, NAME_LEN);
+    }
+
+    entry = &entries[i];
+    entry->mtime = mtime;
+    entry->size = size;
+    memcpy(entry->description, description, SAVEINDEX_DESCRIPTION_LEN);
+    entry->has_thumbnail = (thumbnail != NULL);
+
+    if (thumbnail)
+    {
+        if (!entry->thumbnail)
+        {
+            entry->thumbnail = malloc(THUMBNAIL_SIZE);
+        }
+
+        memcpy(entry->thumbnail, thumbnail, THUMBNAIL_SIZE);
+    }
+    else
+    {
+        free(entry->thumbnail);
+        entry->thumbnail = NULL;
+    }
+
+    if (!WriteRecord(i))
+    {
+        I_Printf(VB_WARNING, "MN_UpdateSaveIndex: Failed to index %s", path);
+    }
+
+    SDL_UnlockMutex(index_lock);
+}
+
+// The lock is taken for one entry at a time, so that the menu isn't kept
+// waiting by the whole batch
+static void PrefetchJob(void *unused)
+{
+    SDL_LockMutex(index_lock);
+
+    const int count = array_size(entries);
+
+    for (int i = 0; i < count; i++)
+    {
+        entries[i].wanted = false;
+    }
+
+    for (int i = 0; i < prefetch_count; i++)
+    {
+        const int entry = FindEntry(prefetch_names[i]);
+
+        if (entry >= 0)
+        {
+            entries[entry].wanted = true;
+        }
+    }
+
+    SDL_UnlockMutex(index_lock);
+
+    for (int i = 0; i < count; i++)
+    {
+        SDL_LockMutex(index_lock);
+
+        if (i < array_size(entries) && index_file)
+        {
+            if (entries[i].wanted)
+            {
+                LoadThumbnail(i);
+            }
+            else
+            {
+                free(entries[i].thumbnail);
+                entries[i].thumbnail = NULL;
+            }
+        }
+
+        SDL_UnlockMutex(index_lock);
+    }
+}
+
+void MN_PrefetchSaveIndex(char **paths, int count)
+{
+    if (!LockIndex())
+    {
+        return;
+    }
+
+    SDL_UnlockMutex(index_lock);
+
+    // The names are shared with the previous job
+    I_WaitForJob(&prefetch_done);
+
+    prefetch_count = MIN(count, MAX_PREFETCH);
+
+    for (int i = 0; i < prefetch_count; i++)
+    {
+        KeyName(prefetch_names[i], paths[i]);
+    }
+
+    prefetch_done = false;
+    I_QueueJob(PrefetchJob, NULL, &prefetch_done);
+}
@@ -0,0 +1,40 @@
+//
+//  Copyright(C) 2024 Alaux
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Index of savegame descriptions and thumbnails
+//
+
+#ifndef __MN_SAVEINDEX__
+#define __MN_SAVEINDEX__
+
+#include "doomtype.h"
+
+// Same as SAVESTRINGSIZE
+#define SAVEINDEX_DESCRIPTION_LEN 24
+
+// Fills in the description of the savegame at `path` and sets `thumbnail`
+// to a copy of its snapshot, or NULL if it has none. Returns false if the
+// savegame is missing from the index, or has changed since it was indexed.
+boolean MN_LookupSaveIndex(const char *path, char *description,
+                           byte **thumbnail);
+
+// Called after a savegame is written or read; `thumbnail` may be NULL
+void MN_UpdateSaveIndex(const char *path, const char *description,
+                        const byte *thumbnail);
+
+// Loads the thumbnails of the given savegames in the background, and drops
+// the other ones from memory
+void MN_PrefetchSaveIndex(char **paths, int count);
+
+#endif
@@ -5676,6 +5676,11 @@ void MN_BindMenuVariables(void)
               66, 0, 100, ss_none, wad_yes,
               "HUD/menu-shadows translucency percent");
 
+    // (CFG-only)
+    M_BindBool("patch_raster_cache", &patch_raster_cache, NULL,
+               true, ss_none, wad_no,
+               "Keep HUD/menu graphics scaled to the current resolution");
+
     BIND_BOOL_GENERAL(quick_quitgame, false, "Skip \"Quit Game\" prompt");
 
     // [Nugget] -------------------------------------------------------------/
@@ -27,7 +27,10 @@
 #include "m_fixed.h"
 #include "m_io.h"
 #include "r_main.h"
+#include "v_flextran.h" // [Nugget]
 #include "v_video.h"
+#include "w_wad.h" // [Nugget]
+#include "z_zone.h" // [Nugget]
 
 static const char snapshot_str[] = "NUGGETDOOM_SNAPSHOT";
 static const int snapshot_len = arrlen(snapshot_str);
@@ -51,6 +54,24 @@ void MN_ResetSnapshot(int i)
     }
 }
 
+// [Nugget] Takes ownership of `data`, which may be NULL
+void MN_SetSnapshot(int i, byte *data)
+{
+    MN_ResetSnapshot(i);
+    snapshots[i] = data;
+}
+
+const byte *MN_GetSnapshot(int i)
+{
+    return snapshots[i];
+}
+
+// [Nugget] The one written by the last call to `MN_WriteSnapshot()`
+const byte *MN_LastSnapshot(void)
+{
+    return current_snapshot;
+}
+
 // [FG] try to read snapshot data from the end of a savegame file
 
 boolean MN_ReadSnapshot(int i, FILE *fp)
@@ -115,17 +136,33 @@ char *MN_GetSavegameTime(int i)
     return savegametimes[i];
 }
 
+// [Nugget] /---------------------------------------------------------------
+
+// The thumbnail is taken from the last presented frame instead of rendering
+// the view again, so unlike before, it includes the HUD. A frame counts only
+// if nothing else was drawn over the view; once the menu, the automap or the
+// pause graphic shows up, the last frame before it is kept instead. That one
+// is still in the video buffer when the next frame starts.
+
+typedef enum
+{
+    SNAPSHOT_NONE,  // No level frame to take the thumbnail from
+    SNAPSHOT_FRAME, // The video buffer holds a clean level frame
+    SNAPSHOT_TAKEN, // `current_snapshot` holds the thumbnail
+} snapshot_state_t;
+
+static snapshot_state_t snapshot_state;
+
+// Samples per axis averaged into each thumbnail pixel, at most
+#define MAX_BOX_SAMPLES 4
+
 // [FG] take a snapshot in SCREENWIDTH*SCREENHEIGHT resolution, i.e.
-//      in hires mode only only each second pixel in each second row is saved,
 //      in widescreen mode only the non-widescreen part in the middle is saved
+// [Nugget] Box-filter the screen down instead of point-sampling it
 
 static void TakeSnapshot(void)
 {
-    int old_screenblocks = screenblocks;
-
-    R_SetViewSize(11);
-    R_ExecuteSetViewSize();
-    R_RenderPlayerView(&players[displayplayer]);
+    const byte *const playpal = W_CacheLumpName("PLAYPAL", PU_CACHE);
 
     if (!current_snapshot)
     {
@@ -134,23 +171,84 @@ static void TakeSnapshot(void)
 
     byte *p = current_snapshot;
 
-    const byte *s = I_VideoBuffer;
-
-    int x, y;
-    for (y = 0; y < SCREENHEIGHT; y++)
+    for (int y = 0; y < SCREENHEIGHT; y++)
     {
-        for (x = video.deltaw; x < NONWIDEWIDTH + video.deltaw; x++)
+        const int y1 = V_ScaleY(y);
+        const int y2 = MAX(y1 + 1, V_ScaleY(y + 1));
+        const int ystep = MAX(1, (y2 - y1) / MAX_BOX_SAMPLES);
+
+        for (int x = video.deltaw; x < NONWIDEWIDTH + video.deltaw; x++)
         {
-            *p++ = s[V_ScaleY(y) * video.pitch + V_ScaleX(x)];
+            const int x1 = V_ScaleX(x);
+            const int x2 = MAX(x1 + 1, V_ScaleX(x + 1));
+            const int xstep = MAX(1, (x2 - x1) / MAX_BOX_SAMPLES);
+            int r = 0, g = 0, b = 0, count = 0;
+
+            for (int sy = y1; sy < y2 && sy < video.height; sy += ystep)
+            {
+                const byte *s = I_VideoBuffer + sy * video.pitch;
+
+                for (int sx = x1; sx < x2 && sx < video.width; sx += xstep)
+                {
+                    const byte *rgb = playpal + s[sx] * 3;
+
+                    r += rgb[0];
+                    g += rgb[1];
+                    b += rgb[2];
+                    count++;
+                }
+            }
+
+            if (count)
+            {
+                *p++ = RGB32k[r / count >> 3][g / count >> 3][b / count >> 3];
+            }
+            else
+            {
+                *p++ = v_darkest_color;
+            }
         }
     }
+}
 
-    R_SetViewSize(old_screenblocks);
+// Called before a frame is drawn
+void MN_SnapshotFrame(void)
+{
+    if (gamestate != GS_LEVEL || !gametic)
+    {
+        snapshot_state = SNAPSHOT_NONE;
+    }
+    else if (!menuactive && automapactive != AM_FULL && !paused)
+    {
+        snapshot_state = SNAPSHOT_FRAME;
+    }
+    else if (snapshot_state == SNAPSHOT_FRAME)
+    {
+        // Something is about to be drawn over the view, so keep the
+        // previous frame
+        TakeSnapshot();
+        snapshot_state = SNAPSHOT_TAKEN;
+    }
 }
 
+// [Nugget] ---------------------------------------------------------------/
+
 void MN_WriteSnapshot(byte *p)
 {
-    TakeSnapshot();
+    // [Nugget] Reuse the last frame
+    if (snapshot_state == SNAPSHOT_FRAME)
+    {
+        TakeSnapshot();
+    }
+    else if (snapshot_state == SNAPSHOT_NONE)
+    {
+        if (!current_snapshot)
+        {
+            current_snapshot = malloc(snapshot_size * sizeof(**snapshots));
+        }
+
+        memset(current_snapshot, v_darkest_color, snapshot_size);
+    }
 
     memcpy(p, snapshot_str, snapshot_len);
     p += snapshot_len;
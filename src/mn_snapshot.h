@@ -25,7 +25,13 @@
 const int MN_SnapshotDataSize(void);
 void MN_ResetSnapshot(int i);
 boolean MN_ReadSnapshot(int i, FILE *fp);
+// [Nugget]
+void MN_SetSnapshot(int i, byte *data);
+const byte *MN_GetSnapshot(int i);
+const byte *MN_LastSnapshot(void);
 void MN_WriteSnapshot(byte *p);
+// [Nugget] Called at the start of every frame, before anything is drawn
+void MN_SnapshotFrame(void);
 boolean MN_DrawSnapshot(int i, int x, int y, int w, int h);
 
 void MN_ReadSavegameTime(int i, char *name);
@@ -29,6 +29,9 @@
 
 #include "doomdata.h"
 #include "doomtype.h"
+#include "i_printf.h"
+#include "i_timer.h"
+#include "m_argv.h"
 #include "m_bbox.h"
 #include "m_fixed.h"
 #include "p_extnodes.h"
@@ -49,6 +52,34 @@
 // (I am not sure exactly why).  higher values are okay.
 #define SPLIT_COST  11
 
+// [Nugget] /-----------------------------------------------------------------
+
+// the render-optimized mode also weighs what the renderer and the
+// line-of-sight code pay for: splitting a seg that gets drawn means
+// more segs to clip and draw, and an unbalanced tree means deeper
+// traversals.  diagonal partitions make R_PointOnSide() slower.
+#define VISIBLE_SPLIT_COST  22
+#define BALANCE_COST        3
+#define DIAGONAL_COST       4
+
+// the render-optimized mode only uses the fast picker on larger
+// groups of segs, since it is rather crude.
+#define RENDER_FAST_THRESHOLD  512
+
+typedef enum
+{
+	BSPMODE_FAST,
+	BSPMODE_RENDER,
+} bspmode_t;
+
+static bspmode_t bsp_mode;
+
+// statistics of the last build
+static int bsp_max_depth;
+static double bsp_depth_area, bsp_total_area;
+
+// [Nugget] -----------------------------------------------------------------/
+
 
 #undef MAX
 #define MAX(a, b)  ((a) > (b) ? (a) : (b))
@@ -254,8 +285,42 @@ nanode_t * BSP_CreateLeaf (seg_t * soup)
 struct NodeEval
 {
 	int left, right, split;
+	int visible_split; // [Nugget]
 };
 
+// [Nugget] Whether anything is drawn for the seg
+static boolean BSP_SegVisible (seg_t * seg)
+{
+	sector_t * front = seg->frontsector;
+	sector_t * back  = seg->backsector;
+
+	if (back == NULL || seg->sidedef->midtexture)
+		return true;
+
+	return (front->floorheight   != back->floorheight   ||
+			front->ceilingheight != back->ceilingheight ||
+			front->floorpic      != back->floorpic      ||
+			front->ceilingpic    != back->ceilingpic    ||
+			front->lightlevel    != back->lightlevel);
+}
+
+// [Nugget] Cost of a viable partition; lower is better
+static int BSP_PartitionCost (seg_t * part, struct NodeEval * eval)
+{
+	int imbalance = abs (eval->left - eval->right);
+
+	if (bsp_mode == BSPMODE_FAST)
+		return imbalance * 2 + eval->split * SPLIT_COST;
+
+	int cost = imbalance * BALANCE_COST + eval->split * SPLIT_COST
+			 + eval->visible_split * VISIBLE_SPLIT_COST;
+
+	if (part->v1->x != part->v2->x && part->v1->y != part->v2->y)
+		cost += DIAGONAL_COST;
+
+	return cost;
+}
+
 int BSP_PointOnSide (seg_t * part, fixed_t x, fixed_t y)
 {
 	x -= part->v1->x;
@@ -359,6 +424,7 @@ boolean BSP_EvalPartition (seg_t * part, seg_t * soup, struct NodeEval * eval)
 	eval->left  = 0;
 	eval->right = 0;
 	eval->split = 0;
+	eval->visible_split = 0; // [Nugget]
 
 	// do not create tiny partitions
 	if (abs (part->v2->x - part->v1->x) < 4*DIST_EPSILON &&
@@ -372,7 +438,14 @@ boolean BSP_EvalPartition (seg_t * part, seg_t * soup, struct NodeEval * eval)
 
 		switch (side)
 		{
-			case  0: eval->split += 1; break;
+			case  0:
+				eval->split += 1;
+
+				// [Nugget]
+				if (bsp_mode == BSPMODE_RENDER && BSP_SegVisible (S))
+					eval->visible_split += 1;
+
+				break;
 			case -1: eval->left  += 1; break;
 			case +1: eval->right += 1; break;
 		}
@@ -397,7 +470,8 @@ seg_t * BSP_PickNode_Fast (seg_t * soup)
 	for (S = soup ; S != NULL ; S = S->next)
 		count += 1;
 
-	if (count < FAST_THRESHOLD)
+	// [Nugget]
+	if (count < (bsp_mode == BSPMODE_RENDER ? RENDER_FAST_THRESHOLD : FAST_THRESHOLD))
 		return NULL;
 
 	// determine bounding box of the segs
@@ -449,8 +523,8 @@ seg_t * BSP_PickNode_Fast (seg_t * soup)
 
 	if (vert_ok && horiz_ok)
 	{
-		int vert_cost  = abs (v_eval.left - v_eval.right) * 2 + v_eval.split * SPLIT_COST;
-		int horiz_cost = abs (h_eval.left - h_eval.right) * 2 + h_eval.split * SPLIT_COST;
+		int vert_cost  = BSP_PartitionCost (vert_part,  &v_eval); // [Nugget]
+		int horiz_cost = BSP_PartitionCost (horiz_part, &h_eval); //
 
 		return (horiz_cost < vert_cost) ? horiz_part : vert_part;
 	}
@@ -478,7 +552,7 @@ seg_t * BSP_PickNode_Slow (seg_t * soup)
 
 		if (BSP_EvalPartition (part, soup, &eval))
 		{
-			int cost = abs (eval.left - eval.right) * 2 + eval.split * SPLIT_COST;
+			int cost = BSP_PartitionCost (part, &eval); // [Nugget]
 
 			if (cost < best_cost)
 			{
@@ -735,7 +809,7 @@ void BSP_WriteSubsector (nanode_t * N)
 	}
 }
 
-unsigned int BSP_WriteNode (nanode_t * N, fixed_t * bbox)
+unsigned int BSP_WriteNode (nanode_t * N, fixed_t * bbox, int depth)
 {
 	unsigned int index = N->index;
 
@@ -745,6 +819,15 @@ unsigned int BSP_WriteNode (nanode_t * N, fixed_t * bbox)
 
 		BSP_BoundingBox (N->segs, bbox);
 		BSP_WriteSubsector (N);
+
+		// [Nugget] weigh the depth of each leaf by its area, as an
+		// estimate of the nodes visited to locate a random point
+		double area = ((double) bbox[BOXRIGHT] - bbox[BOXLEFT]) / FRACUNIT
+					* ((double) bbox[BOXTOP] - bbox[BOXBOTTOM]) / FRACUNIT;
+
+		bsp_max_depth   = MAX (bsp_max_depth, depth);
+		bsp_depth_area += area * depth;
+		bsp_total_area += area;
 	}
 	else
 	{
@@ -760,7 +843,7 @@ unsigned int BSP_WriteNode (nanode_t * N, fixed_t * bbox)
 		{
 			nanode_t * child = (c == 0) ? N->right : N->left;
 
-			out->children[c] = BSP_WriteNode (child, out->bbox[c]);
+			out->children[c] = BSP_WriteNode (child, out->bbox[c], depth + 1);
 		}
 
 		BSP_MergeBounds (bbox, out->bbox[0], out->bbox[1]);
@@ -773,6 +856,30 @@ unsigned int BSP_WriteNode (nanode_t * N, fixed_t * bbox)
 
 void BSP_BuildNodes (void)
 {
+	// [Nugget] /-------------------------------------------------------------
+
+	//!
+	// @arg <mode>
+	// @category mod
+	//
+	// Node-building mode used for -bsp and maps without supported nodes:
+	// 0 builds the fastest (default), 1 optimizes the tree for rendering
+	// and line-of-sight checks.
+	//
+
+	int p = M_CheckParmWithArgs ("-bspmode", 1);
+
+	bsp_mode = (p && M_ParmArgToInt (p) == BSPMODE_RENDER) ? BSPMODE_RENDER
+														  : BSPMODE_FAST;
+
+	const uint64_t start_time = I_GetTimeUS ();
+
+	bsp_max_depth = 0;
+	bsp_depth_area = 0;
+	bsp_total_area = 0;
+
+	// [Nugget] -------------------------------------------------------------/
+
 	seg_t * list = BSP_CreateSegs ();
 
 	nanode_t * root = BSP_SubdivideSegs (list);
@@ -801,5 +908,13 @@ void BSP_BuildNodes (void)
 	fixed_t dummy[4];
 
 	// this also frees stuff as it goes
-	BSP_WriteNode (root, dummy);
+	BSP_WriteNode (root, dummy, 0);
+
+	// [Nugget] Report the shape of the tree, to compare both modes per map
+	I_Printf (VB_DEMO, "BSP_BuildNodes: %s mode, %d nodes, %d segs, "
+			  "%d subsectors, depth %d max / %.1f avg, %d ms",
+			  bsp_mode == BSPMODE_RENDER ? "render" : "fast",
+			  numnodes, numsegs, numsubsectors, bsp_max_depth,
+			  bsp_total_area > 0 ? bsp_depth_area / bsp_total_area : 0.0,
+			  (int) ((I_GetTimeUS () - start_time) / 1000));
 }
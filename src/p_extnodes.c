@@ -368,7 +368,7 @@ void P_LoadNodes_DEEP(int lump)
 
 // [MB] 2020-04-22: Fix endianess for ZDoom extended nodes
 
-static void P_LoadSegs_XNOD(byte *data)
+static void P_LoadSegs_XNOD(const byte *data)
 {
     int i;
 
@@ -378,7 +378,7 @@ static void P_LoadSegs_XNOD(byte *data)
         unsigned int linedef;
         unsigned char side;
         seg_t *li = segs + i;
-        mapseg_xnod_t *ml = (mapseg_xnod_t *)data + i;
+        const mapseg_xnod_t *ml = (const mapseg_xnod_t *)data + i;
         unsigned int v1, v2;
 
         v1 = LONG(ml->v1);
@@ -430,7 +430,7 @@ static void P_LoadSegs_XNOD(byte *data)
 
 // adapted from dsda-doom/prboom2/src/p_setup.c:P_LoadGLZSegs()
 
-static void P_LoadSegs_XGLN(byte *data)
+static void P_LoadSegs_XGLN(const byte *data)
 {
     int i, j;
     const mapseg_xnod_t *ml = (const mapseg_xnod_t *)data;
@@ -555,11 +555,62 @@ static void P_LoadSegs_XGLN(byte *data)
     }
 }
 
+// [Nugget] Sections of the nodes lump are read one at a time: straight out
+// of the cached lump, or inflated into a buffer that only has to hold the
+// largest section, instead of inflating the whole lump up front
+
+typedef struct
+{
+    const byte *pos;
+    z_stream *zstream;
+    byte *buffer;
+    size_t buffer_size;
+} nodereader_t;
+
+static const byte *ReadNodeData(nodereader_t *reader, size_t size)
+{
+    const byte *data;
+    int err = Z_OK;
+
+    if (!reader->zstream)
+    {
+        data = reader->pos;
+        reader->pos += size;
+        return data;
+    }
+
+    if (size > reader->buffer_size)
+    {
+        reader->buffer = Z_Realloc(reader->buffer, size, PU_STATIC, 0);
+        reader->buffer_size = size;
+    }
+
+    reader->zstream->next_out = reader->buffer;
+    reader->zstream->avail_out = size;
+
+    while (reader->zstream->avail_out && err == Z_OK)
+    {
+        err = inflate(reader->zstream, Z_SYNC_FLUSH);
+    }
+
+    if (reader->zstream->avail_out)
+    {
+        I_Error("P_LoadNodes_XNOD: Error during ZNOD nodes decompression!");
+    }
+
+    return reader->buffer;
+}
+
+static unsigned int ReadNodeCount(nodereader_t *reader)
+{
+    return LONG(*((unsigned int *)ReadNodeData(reader, sizeof(unsigned int))));
+}
+
 void P_LoadNodes_XNOD(int lump, boolean compressed, boolean glnodes)
 {
-    byte *data;
+    const byte *data;
     unsigned int i;
-    byte *output = NULL;
+    nodereader_t reader = {0};
 
     unsigned int orgVerts, newVerts;
     unsigned int numSubs, currSeg;
@@ -569,77 +620,31 @@ void P_LoadNodes_XNOD(int lump, boolean compressed, boolean glnodes)
 
     data = W_CacheLumpNum(lump, PU_LEVEL);
 
-    // 0. Uncompress nodes lump (or simply skip header)
+    // 0. Set up decompression of the nodes lump (or simply skip header)
+
+    reader.pos = data + 4;
 
     if (compressed)
     {
         const int len = W_LumpLength(lump);
-        int outlen, err;
-        z_stream *zstream;
-
-        // first estimate for compression rate:
-        // output buffer size == 2.5 * input size
-        outlen = 2.5 * len;
-        output = Z_Malloc(outlen, PU_STATIC, 0);
 
         // initialize stream state for decompression
-        zstream = Z_Malloc(sizeof(*zstream), PU_STATIC, 0);
-        memset(zstream, 0, sizeof(*zstream));
-        zstream->next_in = data + 4;
-        zstream->avail_in = len - 4;
-        zstream->next_out = output;
-        zstream->avail_out = outlen;
-
-        if (inflateInit(zstream) != Z_OK)
-        {
-            I_Error("P_LoadNodes_XNOD: Error during ZNOD nodes decompression "
-                    "initialization!");
-        }
-
-        // resize if output buffer runs full
-        while ((err = inflate(zstream, Z_SYNC_FLUSH)) == Z_OK)
-        {
-            int outlen_old = outlen;
-            outlen = 2 * outlen_old;
-            output = Z_Realloc(output, outlen, PU_STATIC, 0);
-            zstream->next_out = output + outlen_old;
-            zstream->avail_out = outlen - outlen_old;
-        }
+        reader.zstream = Z_Malloc(sizeof(*reader.zstream), PU_STATIC, 0);
+        memset(reader.zstream, 0, sizeof(*reader.zstream));
+        reader.zstream->next_in = (byte *)data + 4;
+        reader.zstream->avail_in = len - 4;
 
-        if (err != Z_STREAM_END)
-        {
-            I_Error("P_LoadNodes_XNOD: Error during ZNOD nodes decompression!");
-        }
-
-        I_Printf(VB_DEBUG,
-                 "P_LoadNodes_XNOD: ZNOD nodes compression ratio %.3f",
-                 (float)zstream->total_out / zstream->total_in);
-
-        data = output;
-
-        if (inflateEnd(zstream) != Z_OK)
+        if (inflateInit(reader.zstream) != Z_OK)
         {
             I_Error("P_LoadNodes_XNOD: Error during ZNOD nodes decompression "
-                    "shut-down!");
+                    "initialization!");
         }
-
-        // release the original data lump
-        W_CacheLumpNum(lump, PU_CACHE);
-        Z_Free(zstream);
-    }
-    else
-    {
-        // skip header
-        data += 4;
     }
 
     // 1. Load new vertices added during node building
 
-    orgVerts = LONG(*((unsigned int *)data));
-    data += sizeof(orgVerts);
-
-    newVerts = LONG(*((unsigned int *)data));
-    data += sizeof(newVerts);
+    orgVerts = ReadNodeCount(&reader);
+    newVerts = ReadNodeCount(&reader);
 
     if (orgVerts + newVerts == (unsigned int)numvertexes)
     {
@@ -653,15 +658,15 @@ void P_LoadNodes_XNOD(int lump, boolean compressed, boolean glnodes)
         memset(newvertarray + orgVerts, 0, newVerts * sizeof(vertex_t));
     }
 
+    data = ReadNodeData(&reader, newVerts * 2 * sizeof(fixed_t));
+
     for (i = 0; i < newVerts; i++)
     {
-        newvertarray[i + orgVerts].r_x = newvertarray[i + orgVerts].x =
-            LONG(*((unsigned int *)data));
-        data += sizeof(newvertarray[0].x);
+        const unsigned int *coords = (const unsigned int *)data + i * 2;
+        vertex_t *v = &newvertarray[i + orgVerts];
 
-        newvertarray[i + orgVerts].r_y = newvertarray[i + orgVerts].y =
-            LONG(*((unsigned int *)data));
-        data += sizeof(newvertarray[0].y);
+        v->r_x = v->x = LONG(coords[0]);
+        v->r_y = v->y = LONG(coords[1]);
     }
 
     if (vertexes != newvertarray)
@@ -679,8 +684,7 @@ void P_LoadNodes_XNOD(int lump, boolean compressed, boolean glnodes)
 
     // 2. Load subsectors
 
-    numSubs = LONG(*((unsigned int *)data));
-    data += sizeof(numSubs);
+    numSubs = ReadNodeCount(&reader);
 
     if (numSubs < 1)
     {
@@ -690,21 +694,20 @@ void P_LoadNodes_XNOD(int lump, boolean compressed, boolean glnodes)
     numsubsectors = numSubs;
     subsectors = Z_Malloc(numsubsectors * sizeof(subsector_t), PU_LEVEL, 0);
 
+    data = ReadNodeData(&reader, numsubsectors * sizeof(mapsubsector_xnod_t));
+
     for (i = currSeg = 0; i < numsubsectors; i++)
     {
-        mapsubsector_xnod_t *mseg = (mapsubsector_xnod_t *)data + i;
+        const mapsubsector_xnod_t *mseg = (const mapsubsector_xnod_t *)data + i;
 
         subsectors[i].firstline = currSeg;
         subsectors[i].numlines = LONG(mseg->numsegs);
         currSeg += LONG(mseg->numsegs);
     }
 
-    data += numsubsectors * sizeof(mapsubsector_xnod_t);
-
     // 3. Load segs
 
-    numSegs = LONG(*((unsigned int *)data));
-    data += sizeof(numSegs);
+    numSegs = ReadNodeCount(&reader);
 
     // The number of stored segs should match the number of segs used by
     // subsectors
@@ -716,6 +719,8 @@ void P_LoadNodes_XNOD(int lump, boolean compressed, boolean glnodes)
     numsegs = numSegs;
     segs = Z_Malloc(numsegs * sizeof(seg_t), PU_LEVEL, 0);
 
+    data = ReadNodeData(&reader, numsegs * sizeof(mapseg_xnod_t));
+
     if (glnodes)
     {
         P_LoadSegs_XGLN(data);
@@ -725,21 +730,20 @@ void P_LoadNodes_XNOD(int lump, boolean compressed, boolean glnodes)
         P_LoadSegs_XNOD(data);
     }
 
-    data += numsegs * sizeof(mapseg_xnod_t);
-
     // 4. Load nodes
 
-    numNodes = LONG(*((unsigned int *)data));
-    data += sizeof(numNodes);
+    numNodes = ReadNodeCount(&reader);
 
     numnodes = numNodes;
     nodes = Z_Malloc(numnodes * sizeof(node_t), PU_LEVEL, 0);
 
+    data = ReadNodeData(&reader, numnodes * sizeof(mapnode_xnod_t));
+
     for (i = 0; i < numnodes; i++)
     {
         int j, k;
         node_t *no = nodes + i;
-        mapnode_xnod_t *mn = (mapnode_xnod_t *)data + i;
+        const mapnode_xnod_t *mn = (const mapnode_xnod_t *)data + i;
 
         no->x = SHORT(mn->x) << FRACBITS;
         no->y = SHORT(mn->y) << FRACBITS;
@@ -757,12 +761,25 @@ void P_LoadNodes_XNOD(int lump, boolean compressed, boolean glnodes)
         }
     }
 
-    if (compressed && output)
+    if (reader.zstream)
     {
-        Z_Free(output);
-    }
-    else
-    {
-        W_CacheLumpNum(lump, PU_CACHE);
+        I_Printf(VB_DEBUG,
+                 "P_LoadNodes_XNOD: ZNOD nodes compression ratio %.3f",
+                 (float)reader.zstream->total_out / reader.zstream->total_in);
+
+        if (inflateEnd(reader.zstream) != Z_OK)
+        {
+            I_Error("P_LoadNodes_XNOD: Error during ZNOD nodes decompression "
+                    "shut-down!");
+        }
+
+        Z_Free(reader.zstream);
+
+        if (reader.buffer)
+        {
+            Z_Free(reader.buffer);
+        }
     }
+
+    W_CacheLumpNum(lump, PU_CACHE);
 }
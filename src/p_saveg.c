@@ -2312,7 +2312,7 @@ typedef enum {
 void P_ArchiveThinkers (void)
 {
   thinker_t *th;
-  size_t    size = 0;
+  size_t    size = 0, chunk, count = 0;
   mobj_t    tmp;
 
   CheckSaveGame(sizeof brain);      // killough 3/26/98: Save boss brain state
@@ -2328,7 +2328,9 @@ void P_ArchiveThinkers (void)
       th->prev = (thinker_t *) ++size;
 
   // check that enough room is available in savegame buffer
-  CheckSaveGame(size*(sizeof(mobj_t)+4));       // killough 2/14/98
+  // [Nugget] Only for one chunk of them, if the savegame is streamed
+  chunk = G_SaveGameStreaming() ? MIN(size, SAVEGAME_CHUNK_MOBJS) : size;
+  CheckSaveGame(chunk*(sizeof(mobj_t)+4));       // killough 2/14/98
 
   // save off the current thinkers
 
@@ -2385,6 +2387,13 @@ void P_ArchiveThinkers (void)
         saveg_write8(tc_mobj);
         saveg_write_pad();
         saveg_write_mobj_t(mobj);
+
+        // [Nugget] Compressed savegames
+        if (chunk < size && !(++count % chunk))
+        {
+          G_FlushSaveGame();
+          CheckSaveGame(chunk*(sizeof(mobj_t)+4));
+        }
       }
 
   // add a terminating marker
@@ -44,6 +44,12 @@ void P_UnArchiveMap(void);
 extern byte *save_p;
 void CheckSaveGame(size_t);              // killough
 
+// [Nugget] Compressed savegames are streamed in parts, the thinkers in
+// chunks of this many mobjs
+#define SAVEGAME_CHUNK_MOBJS 1024
+boolean G_SaveGameStreaming(void);
+void G_FlushSaveGame(void);
+
 byte saveg_read8(void);
 void saveg_write8(byte value);
 int saveg_read32(void);
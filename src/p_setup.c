@@ -30,9 +30,11 @@
 #include "g_compatibility.h"
 #include "i_printf.h"
 #include "i_system.h"
+#include "i_timer.h"
 #include "info.h"
 #include "m_argv.h"
 #include "m_bbox.h"
+#include "m_misc.h"
 #include "m_swap.h"
 #include "nano_bsp.h"
 #include "p_enemy.h"
@@ -1616,6 +1618,32 @@ static boolean P_LoadReject(int lumpnum, int totallines)
     return ret;
 }
 
+// [Nugget] Level-load timing breakdown /------------------------------------
+
+static uint64_t load_start;
+static char load_times[256];
+
+static void P_StartLoadTimes(void)
+{
+  load_start = I_GetTimeUS();
+  load_times[0] = '\0';
+}
+
+// Time since the last call, attributed to the given step
+static void P_MarkLoadTime(const char *step)
+{
+  const uint64_t now = I_GetTimeUS();
+  char entry[32];
+
+  M_snprintf(entry, sizeof(entry), "%s%s %.1f", load_times[0] ? ", " : "",
+             step, (now - load_start) / 1000.0);
+  M_StringConcat(load_times, entry, sizeof(load_times));
+
+  load_start = now;
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 //
 // P_SetupLevel
 //
@@ -1684,13 +1712,19 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   // [FG] check nodes format
   mapformat = P_CheckMapFormat(lumpnum);
 
+  P_StartLoadTimes(); // [Nugget]
+
   P_LoadVertexes  (lumpnum+ML_VERTEXES);
+  P_MarkLoadTime("vertexes"); // [Nugget]
   P_LoadSectors   (lumpnum+ML_SECTORS);
+  P_MarkLoadTime("sectors"); // [Nugget]
   P_LoadSideDefs  (lumpnum+ML_SIDEDEFS);             // killough 4/4/98
   P_LoadLineDefs  (lumpnum+ML_LINEDEFS);             //       |
   P_LoadSideDefs2 (lumpnum+ML_SIDEDEFS);             //       |
   P_LoadLineDefs2 (lumpnum+ML_LINEDEFS);             // killough 4/4/98
+  P_MarkLoadTime("lines"); // [Nugget]
   gen_blockmap = P_LoadBlockMap  (lumpnum+ML_BLOCKMAP);             // killough 3/1/98
+  P_MarkLoadTime("blockmap"); // [Nugget]
   // [FG] build nodes with NanoBSP
   if (mapformat >= MFMT_UNSUPPORTED)
   {
@@ -1717,15 +1751,18 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   P_LoadNodes     (lumpnum+ML_NODES);
   P_LoadSegs      (lumpnum+ML_SEGS);
   }
+  P_MarkLoadTime("nodes"); // [Nugget]
 
   // [FG] pad the REJECT table when the lump is too small
   pad_reject = P_LoadReject (lumpnum+ML_REJECT, P_GroupLines());
+  P_MarkLoadTime("grouping"); // [Nugget]
 
   if (mapformat != MFMT_UNSUPPORTED)
     P_RemoveSlimeTrails();    // killough 10/98: remove slime trails from wad
 
   // [crispy] fix long wall wobble
   P_SegLengths(false);
+  P_MarkLoadTime("fixups"); // [Nugget]
 
   // [Nugget] Key blinking:
   // [crispy] blinking key or skull in the status bar
@@ -1738,6 +1775,7 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   deathmatch_p = deathmatchstarts;
   P_MapStart();
   P_LoadThings(lumpnum+ML_THINGS);
+  P_MarkLoadTime("things"); // [Nugget]
 
   // if deathmatch, randomly spawn the active players
   if (deathmatch)
@@ -1769,6 +1807,10 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   if (precache)
     R_PrecacheLevel();
 
+  // [Nugget] Decode the level's sounds and convert its music in the background
+  S_PrefetchLevelSounds();
+  S_PrefetchLevelMusic();
+
   // [FG] log level setup
   I_Printf(VB_DEMO, "P_SetupLevel: %.8s (%s), Skill %d, %s%s%s, %s",
     lumpname, W_WadNameForLump(lumpnum),
@@ -1783,6 +1825,9 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
     gen_blockmap ? "+Blockmap" : "",
     pad_reject ? "+Reject" : "",
     G_GetCurrentComplevelName());
+
+  // [Nugget]
+  I_Printf(VB_DEMO, "P_SetupLevel: Load times (ms): %s", load_times);
 }
 
 //
@@ -54,6 +54,8 @@ static const char *params[] = {
 "-longtics",
 "-shorttics",
 "-strict",
+"-benchsegloop",
+"-benchwipe",
 "-cdrom", // [Nugged] Restored `-cdrom` parm
 "-nogui",
 };
@@ -72,6 +74,8 @@ static const char *params_with_args[] = {
 "-speed",
 "-turbo",
 "-warp",
+"-perfcsv",
+"-capture",
 "-connect",
 "-dup",
 "-extratics",
@@ -80,6 +84,7 @@ static const char *params_with_args[] = {
 "-port",
 "-servername",
 "-timer",
+"-bspmode",
 "-bex",
 "-bexout",
 "-deh",
@@ -92,12 +97,15 @@ static const char *params_with_args[] = {
 "-recordfromto",
 "-skipsec",
 "-timedemo",
+"-benchopl",
+"-benchmusic",
 "-cl",
 "-complevel",
 "-gameversion",
 "-setmem",
 "-spechit",
 "-statdump",
+"-threads",
 };
 
 #define HELP_STRING "Usage: nugget-doom [options] \n\
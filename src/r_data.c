@@ -139,6 +139,17 @@ int       *flatterrain;
 int       *texturetranslation;
 const byte **texturebrightmap; // [crispy] brightmaps
 
+// [Nugget] Composite cache /--------------------------------------------------
+
+int composite_cache_mb; // Memory budget for composites (0 = unlimited)
+
+static unsigned *texturelastframe; // Cache frame in which texture was last used
+static unsigned cacheframe = 1;
+static size_t composite_bytes;
+static int composite_hits, composite_misses;
+
+// [Nugget] ------------------------------------------------------------------/
+
 
 // needed for pre-rendering
 fixed_t   *spritewidth, *spriteoffset, *spritetopoffset;
@@ -216,6 +227,10 @@ static void R_DrawColumnInCache(const column_t *patch, byte *cache,
 
 static void R_GenerateComposite(int texnum)
 {
+  // [Nugget] Both blocks are regenerated together, so drop any survivor
+  Z_Free(texturecomposite[texnum]);
+  Z_Free(texturecomposite2[texnum]);
+
   byte *block = Z_Malloc(texturecompositesize[texnum], PU_STATIC,
                          (void **) &texturecomposite[texnum]);
   texture_t *texture = textures[texnum];
@@ -319,6 +334,115 @@ static void R_GenerateComposite(int texnum)
 
   Z_ChangeTag(block, PU_CACHE);
   Z_ChangeTag(block2, PU_CACHE);
+
+  // [Nugget] Account for the composite in the cache budget
+  composite_bytes += texturecompositesize[texnum]
+                     + texture->width * texture->height;
+  composite_misses++;
+  texturelastframe[texnum] = cacheframe;
+}
+
+//
+// [Nugget] Composite cache
+//
+// Composites are generated on first use and kept across levels, so that
+// textures shared by many maps stay hot. Once the total size exceeds
+// composite_cache_mb, the least recently used ones are freed at the start
+// of the next frame, when no column pointers into them are held.
+//
+
+static inline void R_TouchComposite(int tex)
+{
+  if (texturelastframe[tex] != cacheframe)
+  {
+    texturelastframe[tex] = cacheframe;
+    composite_hits++;
+  }
+}
+
+static void R_FreeComposite(int tex)
+{
+  Z_Free(texturecomposite[tex]);
+  Z_Free(texturecomposite2[tex]);
+}
+
+static size_t R_CompositeSize(int tex)
+{
+  size_t size = 0;
+
+  if (texturecomposite[tex])
+    size += texturecompositesize[tex];
+  if (texturecomposite2[tex])
+    size += textures[tex]->width * textures[tex]->height;
+
+  return size;
+}
+
+static int CompareLastFrame(const void *a, const void *b)
+{
+  const unsigned fa = texturelastframe[*(const int *) a];
+  const unsigned fb = texturelastframe[*(const int *) b];
+
+  return (fa > fb) - (fa < fb);
+}
+
+void R_TrimCompositeCache(void)
+{
+  const size_t budget = (size_t) composite_cache_mb << 20;
+  int *resident;
+  int i, count = 0;
+
+  cacheframe++;
+
+  // The counters cover one frame
+  composite_hits = composite_misses = 0;
+
+  if (!budget || composite_bytes <= budget)
+    return;
+
+  // Zone purges of PU_CACHE blocks bypass the accounting, so recount
+  composite_bytes = 0;
+  resident = Z_Malloc(numtextures * sizeof(*resident), PU_STATIC, 0);
+
+  for (i = 0; i < numtextures; i++)
+  {
+    const size_t size = R_CompositeSize(i);
+
+    if (size)
+    {
+      composite_bytes += size;
+      resident[count++] = i;
+    }
+  }
+
+  if (composite_bytes > budget)
+  {
+    // Evict down to 7/8 of the budget, so this doesn't run every frame
+    const size_t target = budget - budget / 8;
+
+    qsort(resident, count, sizeof(*resident), CompareLastFrame);
+
+    for (i = 0; i < count && composite_bytes > target; i++)
+    {
+      const int tex = resident[i];
+
+      // Never evict what the previous frame drew
+      if (cacheframe - texturelastframe[tex] <= 1)
+        break;
+
+      composite_bytes -= R_CompositeSize(tex);
+      R_FreeComposite(tex);
+    }
+  }
+
+  Z_Free(resident);
+}
+
+void R_GetCompositeCacheStats(size_t *bytes, int *hits, int *misses)
+{
+  *bytes = composite_bytes;
+  *hits = composite_hits;
+  *misses = composite_misses;
 }
 
 //
@@ -504,23 +628,41 @@ byte *R_GetColumn(int tex, int col)
 
   if (!texturecomposite2[tex])
     R_GenerateComposite(tex);
+  else
+    R_TouchComposite(tex); // [Nugget]
 
   return texturecomposite2[tex] + ofs;
 }
 
+// [Nugget]
+void R_GetTextureColumns(int tex, texcolumns_t *tc)
+{
+  if (!texturecomposite2[tex])
+    R_GenerateComposite(tex);
+  else
+    R_TouchComposite(tex);
+
+  tc->data = texturecomposite2[tex];
+  tc->colofs = texturecolumnofs2[tex];
+  tc->widthmask = texturewidthmask[tex];
+  tc->generation = z_free_generation;
+}
+
 // [FG] wrapping column getter function for composited translucent mid-textures on 2S walls
 byte *R_GetColumnMod(int tex, int col)
 {
   int ofs;
 
-  while (col < 0)
-    col += texturewidth[tex];
-
+  // [Nugget] Wrap negative columns without looping
   col %= texturewidth[tex];
+  if (col < 0)
+    col += texturewidth[tex];
   ofs  = texturecolumnofs[tex][col];
 
   if (!texturecomposite[tex])
     R_GenerateComposite(tex);
+  else
+    R_TouchComposite(tex); // [Nugget]
 
   return texturecomposite[tex] + ofs;
 }
@@ -530,14 +672,16 @@ byte *R_GetColumnMod2(int tex, int col)
 {
   int ofs;
 
-  while (col < 0)
-    col += texturewidth[tex];
-
+  // [Nugget] Wrap negative columns without looping
   col %= texturewidth[tex];
+  if (col < 0)
+    col += texturewidth[tex];
   ofs  = texturecolumnofs2[tex][col];
 
   if (!texturecomposite2[tex])
     R_GenerateComposite(tex);
+  else
+    R_TouchComposite(tex); // [Nugget]
 
   return texturecomposite2[tex] + ofs;
 }
@@ -643,6 +787,8 @@ void R_InitTextures (void)
     Z_Malloc(numtextures*sizeof*texturecomposite2, PU_STATIC, 0);
   texturecompositesize =
     Z_Malloc(numtextures*sizeof*texturecompositesize, PU_STATIC, 0);
+  texturelastframe = // [Nugget]
+    Z_Calloc(numtextures, sizeof*texturelastframe, PU_STATIC, 0);
   texturewidthmask =
     Z_Malloc(numtextures*sizeof*texturewidthmask, PU_STATIC, 0);
   texturewidth =
@@ -1292,6 +1438,9 @@ void R_PrecacheLevel(void)
         int j = texture->patchcount;
         while (--j >= 0)
           V_CachePatchNum(texture->patches[j].patch, PU_CACHE);
+
+        // [Nugget] Build (or keep hot) the composite too
+        R_GetColumn(i, 0);
       }
 
   // Precache sprites.
@@ -28,6 +28,31 @@ byte *R_GetColumn(int tex, int col);
 byte *R_GetColumnMod(int tex, int col);
 byte *R_GetColumnMod2(int tex, int col);
 
+// [Nugget] Composite cache
+extern int composite_cache_mb;
+void R_TrimCompositeCache(void);
+void R_GetCompositeCacheStats(size_t *bytes, int *hits, int *misses);
+
+// [Nugget] Opaque columns of a texture, resolved once per seg so that the
+// wall loop does a single indexed load per column. Valid until the next
+// R_TrimCompositeCache() call, or until any zone block is freed, since
+// generating another composite may purge this one; `generation` holds
+// `z_free_generation` as of the lookup.
+typedef struct
+{
+  byte *data;             // Opaque composite
+  const unsigned *colofs; // Offset of each column into data
+  int widthmask;
+  unsigned int generation;
+} texcolumns_t;
+
+void R_GetTextureColumns(int tex, texcolumns_t *tc);
+
+inline static byte *R_TextureColumn(const texcolumns_t *tc, int col)
+{
+  return tc->data + tc->colofs[col & tc->widthmask];
+}
+
 // I/O, setting up the stuff.
 void R_InitData (void);
 void R_PrecacheLevel (void);
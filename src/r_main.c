@@ -48,6 +48,7 @@
 #include "r_things.h"
 #include "r_voxel.h"
 #include "m_config.h"
+#include "m_perf.h" // [Nugget]
 #include "st_stuff.h"
 #include "v_flextran.h"
 #include "v_video.h"
@@ -1065,6 +1066,8 @@ void R_Init (void)
 
   colfunc = R_DrawColumn;
   R_InitDrawFunctions();
+
+  R_InitSegLoopBenchmark(); // [Nugget]
 }
 
 //
@@ -1525,6 +1528,8 @@ static boolean no_killough_face; // [Nugget]
 void R_RenderPlayerView (player_t* player)
 {
   R_ClearStats();
+  R_TrimCompositeCache(); // [Nugget]
+  R_SegLoopBenchmarkFrame(); // [Nugget]
 
   { // [Nugget] FOV effects
     float targetfov = custom_fov;
@@ -1650,7 +1655,9 @@ void R_RenderPlayerView (player_t* player)
     }
   }
 
+  M_PerfStart(PERF_SETUPFRAME); // [Nugget]
   R_SetupFrame (player);
+  M_PerfStop(PERF_SETUPFRAME); // [Nugget]
 
   // Clear buffers.
   R_ClearClipSegs ();
@@ -1734,9 +1741,11 @@ void R_RenderPlayerView (player_t* player)
   NetUpdate ();
 
   // The head node is the last node output.
+  M_PerfStart(PERF_BSP); // [Nugget]
   R_RenderBSPNode (numnodes-1);
 
   R_NearbySprites ();
+  M_PerfStop(PERF_BSP); // [Nugget]
 
   // [FG] update automap while playing
   if (automap_on)
@@ -1745,14 +1754,18 @@ void R_RenderPlayerView (player_t* player)
   // Check for new console commands.
   NetUpdate ();
 
+  M_PerfStart(PERF_PLANES); // [Nugget]
   R_DrawPlanes ();
+  M_PerfStop(PERF_PLANES); // [Nugget]
 
   // Check for new console commands.
   NetUpdate ();
 
   // [crispy] draw fuzz effect independent of rendering frame rate
   R_SetFuzzPosDraw();
+  M_PerfStart(PERF_MASKED); // [Nugget]
   R_DrawMasked ();
+  M_PerfStop(PERF_MASKED); // [Nugget]
 
   // Check for new console commands.
   NetUpdate ();
@@ -1817,6 +1830,10 @@ void R_BindRenderVariables(void)
 
   BIND_NUM(screenblocks, 10, 3, 12, "Size of game-world screen");
 
+  // [Nugget] (CFG-only)
+  BIND_NUM(composite_cache_mb, 256, 0, 4096,
+           "Memory budget for composited wall textures, in MiB (0 = Unlimited)");
+
   M_BindBool("translucency", &translucency, NULL, true, ss_gen, wad_yes,
              "Translucency for some things");
   M_BindNum("tran_filter_pct", &tran_filter_pct, NULL,
@@ -25,7 +25,10 @@
 #include "doomdata.h"
 #include "doomstat.h"
 #include "doomtype.h"
+#include "i_printf.h"
 #include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
 #include "m_fixed.h"
 #include "r_bmaps.h" // [crispy] brightmaps
 #include "r_bsp.h"
@@ -333,11 +336,25 @@ void R_FixWiggle (sector_t *sector)
 
 static boolean didsolidcol; // True if at least one column was marked solid
 
-static void R_RenderSegLoop (void)
+// [Nugget] Column tables of the wall tiers, resolved once per seg, the
+// first time that a tier draws a column. Generating one tier's composite
+// may purge another's, so they are looked up again after any zone free.
+static texcolumns_t topcolumns, midcolumns, bottomcolumns;
+
+static inline byte *TierColumn(texcolumns_t *tc, int tex, int col)
 {
-  fixed_t  texturecolumn = 0;   // shut up compiler warning
+  if (!tc->data || tc->generation != z_free_generation)
+    R_GetTextureColumns(tex, tc);
 
-  rendered_segs++;
+  return R_TextureColumn(tc, col);
+}
+
+// [Nugget] With `legacy` set, look every column up through R_GetColumn()
+// instead, which is only done for the -benchsegloop comparison. Forced
+// inline, so that each call site gets a copy without the branch.
+static ALWAYS_INLINE void RenderSegLoop(const boolean legacy)
+{
+  fixed_t  texturecolumn = 0;   // shut up compiler warning
 
   for ( ; rw_x < rw_stopx ; rw_x++)
     {
@@ -406,7 +423,9 @@ static void R_RenderSegLoop (void)
           dc_yl = yl;     // single sided line
           dc_yh = yh;
           dc_texturemid = rw_midtexturemid;
-          dc_source = R_GetColumn(midtexture, texturecolumn);
+          dc_source = legacy ? R_GetColumn(midtexture, texturecolumn)
+                             : TierColumn(&midcolumns, midtexture,
+                                          texturecolumn);
           dc_texheight = textureheight[midtexture]>>FRACBITS; // killough
           dc_brightmap = texturebrightmap[midtexture];
           colfunc ();
@@ -430,7 +449,9 @@ static void R_RenderSegLoop (void)
                   dc_yl = yl;
                   dc_yh = mid;
                   dc_texturemid = rw_toptexturemid;
-                  dc_source = R_GetColumn(toptexture,texturecolumn);
+                  dc_source = legacy ? R_GetColumn(toptexture, texturecolumn)
+                                     : TierColumn(&topcolumns, toptexture,
+                                                  texturecolumn);
                   dc_texheight = textureheight[toptexture]>>FRACBITS;//killough
                   dc_brightmap = texturebrightmap[toptexture];
                   colfunc ();
@@ -457,8 +478,9 @@ static void R_RenderSegLoop (void)
                   dc_yl = mid;
                   dc_yh = yh;
                   dc_texturemid = rw_bottomtexturemid;
-                  dc_source = R_GetColumn(bottomtexture,
-                                          texturecolumn);
+                  dc_source = legacy ? R_GetColumn(bottomtexture, texturecolumn)
+                                     : TierColumn(&bottomcolumns, bottomtexture,
+                                                  texturecolumn);
                   dc_texheight = textureheight[bottomtexture]>>FRACBITS; // killough
                   dc_brightmap = texturebrightmap[bottomtexture];
                   colfunc ();
@@ -491,6 +513,81 @@ static void R_RenderSegLoop (void)
     }
 }
 
+// [Nugget] -benchsegloop /---------------------------------------------------
+
+static boolean benchsegloop, bench_legacy;
+static uint64_t bench_time[2];
+static unsigned int bench_segs[2], bench_frames[2];
+
+static void PrintSegLoopBenchmark(void)
+{
+  static const char *names[2] = {"Column tables", "R_GetColumn()"};
+  int i;
+
+  for (i = 0; i < 2; i++)
+    if (bench_frames[i])
+      I_Printf(VB_ALWAYS, "R_RenderSegLoop (%s): %u frames, %u segs, "
+               "%.1f us/frame, %.3f us/seg", names[i], bench_frames[i],
+               bench_segs[i], (double) bench_time[i] / bench_frames[i],
+               bench_segs[i] ? (double) bench_time[i] / bench_segs[i] : 0.0);
+}
+
+void R_InitSegLoopBenchmark(void)
+{
+  //!
+  // @category obscure
+  //
+  // Alternate every frame between resolving wall textures once per seg and
+  // looking up every column through R_GetColumn(), and print the time
+  // spent in R_RenderSegLoop for each upon exit. Best used with -timedemo.
+  //
+
+  if (M_CheckParm("-benchsegloop"))
+  {
+    benchsegloop = true;
+    I_AtExit(PrintSegLoopBenchmark, false);
+  }
+}
+
+void R_SegLoopBenchmarkFrame(void)
+{
+  if (benchsegloop)
+  {
+    bench_legacy = !bench_legacy;
+    bench_frames[bench_legacy]++;
+  }
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
+static void R_RenderSegLoop (void)
+{
+  uint64_t start = 0;
+
+  rendered_segs++;
+
+  if (benchsegloop)
+  {
+    bench_segs[bench_legacy]++;
+    start = I_GetTimeUS();
+
+    if (bench_legacy)
+    {
+      RenderSegLoop(true);
+      bench_time[1] += I_GetTimeUS() - start;
+      return;
+    }
+  }
+
+  // [Nugget] Resolve the tiers once instead of once per column
+  midcolumns.data = topcolumns.data = bottomcolumns.data = NULL;
+
+  RenderSegLoop(false);
+
+  if (benchsegloop)
+    bench_time[0] += I_GetTimeUS() - start;
+}
+
 // below function is ripped from Crispy
 // WiggleFix: move R_ScaleFromGlobalAngle function to r_segs.c,
 // above R_StoreWallRange
@@ -27,6 +27,10 @@ struct drawseg_s;
 void R_RenderMaskedSegRange(struct drawseg_s *ds, int x1, int x2);
 void R_StoreWallRange(int start, int stop);
 
+// [Nugget] -benchsegloop
+void R_InitSegLoopBenchmark(void);
+void R_SegLoopBenchmarkFrame(void);
+
 extern lighttable_t **walllights;
 
 #endif
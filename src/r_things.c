@@ -421,6 +421,13 @@ void R_DrawMaskedColumn(column_t *column)
   dc_texturemid = basetexturemid;
 }
 
+// [Nugget] Set by the dynamic resolution controller under heavy load, only if
+// `dynamic_sprite_detail` is enabled (off by default).
+// Translucency is dropped for sprites farther away than this, which saves
+// reading back the screen for them.
+#define REDUCED_DETAIL_DIST (1024 * FRACUNIT)
+boolean reduced_sprite_detail;
+
 //
 // R_DrawVisSprite
 //  mfloorclip and mceilingclip should also be set.
@@ -458,7 +465,10 @@ void R_DrawVisSprite(vissprite_t *vis, int x1, int x2)
       }
     else
       if (translucency && !(strictmode && demo_compatibility)
-          && vis->mobjflags & MF_TRANSLUCENT) // phares
+          && vis->mobjflags & MF_TRANSLUCENT // phares
+          // [Nugget] Distant sprites are drawn opaque under heavy load
+          && !(reduced_sprite_detail
+               && vis->scale < FixedDiv(projection, REDUCED_DETAIL_DIST)))
         {
           colfunc = R_DrawTLColumn;
           tranmap = main_tranmap;       // killough 4/11/98
@@ -45,6 +45,7 @@ extern boolean flipcorpses;
 extern lighttable_t **spritelights;
 
 extern boolean draw_nearby_sprites;
+extern boolean reduced_sprite_detail; // [Nugget]
 
 void R_DrawMaskedColumn(column_t *column);
 void R_SortVisSprites(void);
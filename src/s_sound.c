@@ -20,18 +20,22 @@
 // killough 3/7/98: modified to allow arbitrary listeners in spy mode
 // killough 5/2/98: reindented, removed useless code, beautified
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "doomdef.h"
 #include "doomstat.h"
+#include "i_muscache.h"
 #include "i_printf.h"
 #include "i_rumble.h"
 #include "i_sound.h"
 #include "i_system.h"
+#include "m_array.h"
 #include "m_config.h"
 #include "m_misc.h"
 #include "m_random.h"
 #include "p_mobj.h"
+#include "p_tick.h"
 #include "s_musinfo.h" // [crispy] struct musinfo
 #include "s_sound.h"
 #include "s_trakinfo.h"
@@ -86,6 +90,232 @@ int snd_channels;
 // jff 3/17/98 to keep track of last IDMUS specified music num
 int idmusnum;
 
+// [Nugget] /-----------------------------------------------------------------
+
+// Voice pool: the busy channels are kept in a max-heap ordered by priority
+// value (the higher the value, the less important the sound), so the
+// channel to take over is always at the top, plus a bitmask for finding a
+// free one.
+
+static int voice_heap[MAX_CHANNELS];
+static int heap_slot[MAX_CHANNELS]; // Index in `voice_heap` + 1, 0 if free
+static int heap_size;
+static uint32_t busy_voices;
+
+// Number of channels the pool currently spans
+static int pool_channels = MAX_CHANNELS;
+
+// Identical sounds started in the same tic within this distance are merged
+int snd_merge_dist;
+
+#define MAX_RECENT_STARTS 64
+
+typedef struct
+{
+    int sfx_id;
+    fixed_t x, y;
+} recent_start_t;
+
+static recent_start_t recent_starts[MAX_RECENT_STARTS];
+static int num_recent_starts;
+static int recent_starts_tic = -1;
+
+// Since the start of the level
+static int voices_started, voices_dropped, voices_merged;
+
+static void HeapSwap(int a, int b)
+{
+    const int tmp = voice_heap[a];
+
+    voice_heap[a] = voice_heap[b];
+    voice_heap[b] = tmp;
+
+    heap_slot[voice_heap[a]] = a + 1;
+    heap_slot[voice_heap[b]] = b + 1;
+}
+
+static int HeapPriority(int i)
+{
+    return channels[voice_heap[i]].priority;
+}
+
+static void HeapUp(int i)
+{
+    while (i > 0)
+    {
+        const int parent = (i - 1) / 2;
+
+        if (HeapPriority(i) <= HeapPriority(parent))
+        {
+            break;
+        }
+
+        HeapSwap(i, parent);
+        i = parent;
+    }
+}
+
+static void HeapDown(int i)
+{
+    while (true)
+    {
+        const int left = 2 * i + 1, right = left + 1;
+        int largest = i;
+
+        if (left < heap_size && HeapPriority(left) > HeapPriority(largest))
+        {
+            largest = left;
+        }
+
+        if (right < heap_size && HeapPriority(right) > HeapPriority(largest))
+        {
+            largest = right;
+        }
+
+        if (largest == i)
+        {
+            break;
+        }
+
+        HeapSwap(i, largest);
+        i = largest;
+    }
+}
+
+static void VoiceBusy(int cnum)
+{
+    if (heap_slot[cnum])
+    {
+        return;
+    }
+
+    voice_heap[heap_size++] = cnum;
+    heap_slot[cnum] = heap_size;
+    busy_voices |= 1u << cnum;
+    HeapUp(heap_size - 1);
+}
+
+static void VoiceFree(int cnum)
+{
+    const int i = heap_slot[cnum] - 1;
+
+    if (i < 0)
+    {
+        return;
+    }
+
+    heap_size--;
+
+    if (i != heap_size)
+    {
+        HeapSwap(i, heap_size);
+        HeapUp(i);
+        HeapDown(heap_slot[voice_heap[i]] - 1);
+    }
+
+    heap_slot[cnum] = 0;
+    busy_voices &= ~(1u << cnum);
+}
+
+static void VoicePriorityChanged(int cnum)
+{
+    const int i = heap_slot[cnum] - 1;
+
+    if (i >= 0)
+    {
+        HeapUp(i);
+        HeapDown(heap_slot[cnum] - 1);
+    }
+}
+
+static int LowestFreeVoice(void)
+{
+    uint32_t free_voices = ~busy_voices;
+    int cnum = 0;
+
+    if (pool_channels < 32)
+    {
+        free_voices &= (1u << pool_channels) - 1;
+    }
+
+    if (!free_voices)
+    {
+        return -1;
+    }
+
+    while (!(free_voices & 1))
+    {
+        free_voices >>= 1;
+        cnum++;
+    }
+
+    return cnum;
+}
+
+static void ResetRecentStarts(void)
+{
+    if (recent_starts_tic != gametic)
+    {
+        recent_starts_tic = gametic;
+        num_recent_starts = 0;
+    }
+}
+
+static boolean MergeSound(const mobj_t *origin, int sfx_id)
+{
+    const fixed_t dist = snd_merge_dist << FRACBITS;
+
+    if (!snd_merge_dist || !origin)
+    {
+        return false;
+    }
+
+    ResetRecentStarts();
+
+    for (int i = 0; i < num_recent_starts; i++)
+    {
+        const recent_start_t *r = &recent_starts[i];
+
+        if (r->sfx_id == sfx_id && abs(r->x - origin->x) <= dist
+            && abs(r->y - origin->y) <= dist)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Only sounds that actually started can absorb later ones
+static void RecordSoundStart(const mobj_t *origin, int sfx_id)
+{
+    if (!snd_merge_dist || !origin)
+    {
+        return;
+    }
+
+    ResetRecentStarts();
+
+    if (num_recent_starts < MAX_RECENT_STARTS)
+    {
+        recent_start_t *r = &recent_starts[num_recent_starts++];
+
+        r->sfx_id = sfx_id;
+        r->x = origin->x;
+        r->y = origin->y;
+    }
+}
+
+void S_GetVoiceStats(int *active, int *started, int *dropped, int *merged)
+{
+    *active = heap_size;
+    *started = voices_started;
+    *dropped = voices_dropped;
+    *merged = voices_merged;
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 //
 // Internals.
 //
@@ -108,6 +338,8 @@ static void S_StopChannel(int cnum)
     {
         I_StopSound(channels[cnum].handle); // stop the sound playing
 
+        VoiceFree(cnum); // [Nugget]
+
         // haleyjd 09/27/06: clear the entire channel
         memset(&channels[cnum], 0, sizeof(channel_t));
     }
@@ -122,6 +354,33 @@ void S_StopChannels(void)
 
     memset(channels, 0, sizeof(channels));
     memset(sobjs, 0, sizeof(sobjs));
+
+    // [Nugget]
+    memset(heap_slot, 0, sizeof(heap_slot));
+    heap_size = 0;
+    busy_voices = 0;
+    pool_channels = snd_channels;
+}
+
+// [Nugget] Stop the channels left out after the channel count was lowered
+static void SyncVoicePool(void)
+{
+    if (pool_channels == snd_channels)
+    {
+        return;
+    }
+
+    for (int cnum = snd_channels; cnum < pool_channels; cnum++)
+    {
+        if (channels[cnum].sfxinfo)
+        {
+            I_StopSound(channels[cnum].handle);
+            VoiceFree(cnum);
+            memset(&channels[cnum], 0, sizeof(channel_t));
+        }
+    }
+
+    pool_channels = snd_channels;
 }
 
 //
@@ -139,6 +398,31 @@ static int S_AdjustSoundParams(const mobj_t *listener, const mobj_t *source,
     return I_AdjustSoundParams(listener, source, chanvol, vol, sep, pri);
 }
 
+// [Nugget] /-----------------------------------------------------------------
+
+//
+// S_OutOfRange
+//
+// Cheap rejection of sources that every sound module would clip anyway.
+// The distance they compute is never below the larger of the two axis
+// deltas, so this never culls a sound that would have been audible.
+//
+static boolean S_OutOfRange(const mobj_t *listener, const mobj_t *source)
+{
+    // One unit of slack for the truncation of the coordinates
+    const int range = (S_CLIPPING_DIST >> FRACBITS) + 1;
+
+    if (!listener || !source)
+    {
+        return false;
+    }
+
+    return abs((listener->x >> FRACBITS) - (source->x >> FRACBITS)) > range
+           || abs((listener->y >> FRACBITS) - (source->y >> FRACBITS)) > range;
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 //
 // S_getChannel :
 //
@@ -151,8 +435,8 @@ static int S_getChannel(const mobj_t *origin, sfxinfo_t *sfxinfo, int priority,
 {
     // channel number to use
     int cnum;
-    int lowestpriority = -1; // haleyjd
-    int lpcnum = -1;
+
+    SyncVoicePool(); // [Nugget]
 
     // haleyjd 09/28/06: moved this here. If we kill a sound already
     // being played, we can use that channel. There is no need to
@@ -161,47 +445,38 @@ static int S_getChannel(const mobj_t *origin, sfxinfo_t *sfxinfo, int priority,
     // kill old sound
     // killough 12/98: replace is_pickup hack with singularity flag
     // haleyjd 06/12/08: only if subchannel matches
-    for (cnum = 0; cnum < snd_channels; cnum++)
+    // [Nugget] Only the busy channels need to be checked
+    for (int i = 0; i < heap_size; i++)
     {
-        if (channels[cnum].sfxinfo && channels[cnum].singularity == singularity
+        cnum = voice_heap[i];
+
+        if (channels[cnum].singularity == singularity
             && channels[cnum].origin == origin)
         {
             S_StopChannel(cnum);
-            break;
+            return cnum;
         }
     }
 
     // Find an open channel
-    if (cnum == snd_channels)
-    {
-        // haleyjd 09/28/06: it isn't necessary to look for playing sounds in
-        // the same singularity class again, as we just did that above. Here
-        // we are looking for an open channel. We will also keep track of the
-        // channel found with the lowest sound priority while doing this.
-        for (cnum = 0; cnum < snd_channels && channels[cnum].sfxinfo; cnum++)
-        {
-            if (channels[cnum].priority > lowestpriority)
-            {
-                lowestpriority = channels[cnum].priority;
-                lpcnum = cnum;
-            }
-        }
-    }
+    // [Nugget] Take the lowest free one from the pool
+    cnum = LowestFreeVoice();
 
     // None available?
-    if (cnum == snd_channels)
+    if (cnum < 0)
     {
         // Look for lower priority
-        // haleyjd: we have stored the channel found with the lowest priority
-        // in the loop above
-        if (priority > lowestpriority)
+        // [Nugget] The channel with the lowest priority tops the heap
+        cnum = voice_heap[0];
+
+        if (priority > channels[cnum].priority)
         {
+            voices_dropped++; // [Nugget]
             return -1; // No lower priority.  Sorry, Charlie.
         }
         else
         {
-            S_StopChannel(lpcnum); // Otherwise, kick out lowest priority.
-            cnum = lpcnum;
+            S_StopChannel(cnum); // Otherwise, kick out lowest priority.
         }
     }
 
@@ -247,6 +522,13 @@ static void StartSound(const mobj_t *origin, int sfx_id,
 
     sfx = &S_sfx[sfx_id];
 
+    // [Nugget] An identical sound was already started nearby this tic
+    if (MergeSound(origin, sfx_id))
+    {
+        voices_merged++;
+        return;
+    }
+
     // Initialize sound parameters
     pitch = NORM_PITCH;
 
@@ -331,6 +613,11 @@ static void StartSound(const mobj_t *origin, int sfx_id,
         channels[cnum].singularity = singularity;
         channels[cnum].idnum = I_SoundID(handle); // unique instance id
 
+        // [Nugget]
+        VoiceBusy(cnum);
+        voices_started++;
+        RecordSoundStart(origin, sfx_id);
+
         if (rumble_type != RUMBLE_NONE)
         {
             I_StartRumble(players[displayplayer].mo, origin, sfx, handle,
@@ -636,8 +923,14 @@ void S_UpdateSounds(const mobj_t *listener)
     // [Nugget] Freecam
     if (R_GetFreecamOn() && !nodrawers) { listener = viewplayer->mo; }
 
+    // [Nugget] The channel count may have been changed since the last tic
+    SyncVoicePool();
+
+    // [Nugget] Push the listener and every channel in one deferred batch
     I_DeferSoundUpdates();
 
+    I_UpdateListenerParams(listener);
+
     for (cnum = 0; cnum < snd_channels; ++cnum)
     {
         channel_t *c = &channels[cnum];
@@ -647,6 +940,7 @@ void S_UpdateSounds(const mobj_t *listener)
         if (c->idnum != I_SoundID(c->handle))
         {
             // clear the channel and keep going
+            VoiceFree(cnum); // [Nugget]
             memset(c, 0, sizeof(channel_t));
             continue;
         }
@@ -665,7 +959,9 @@ void S_UpdateSounds(const mobj_t *listener)
 
                 if (c->origin && listener != c->origin) // killough 3/20/98
                 {
-                    if (!S_AdjustSoundParams(listener, c->origin, c->volume,
+                    // [Nugget] Cull far sources before they reach the module
+                    if (S_OutOfRange(listener, c->origin)
+                        || !S_AdjustSoundParams(listener, c->origin, c->volume,
                                              &volume, &sep, &pri))
                     {
                         S_StopChannel(cnum);
@@ -674,6 +970,7 @@ void S_UpdateSounds(const mobj_t *listener)
                     {
                         I_UpdateSoundParams(c->handle, volume, sep);
                         c->priority = pri; // haleyjd
+                        VoicePriorityChanged(cnum); // [Nugget]
                     }
                 }
 
@@ -686,7 +983,6 @@ void S_UpdateSounds(const mobj_t *listener)
         }
     }
 
-    I_UpdateListenerParams(listener);
     I_ProcessSoundUpdates();
     I_UpdateRumble();
 }
@@ -927,6 +1223,21 @@ static inline int WRAP(int i, int w)
     return i % w;
 }
 
+// [Nugget] Default music of the given map
+
+static int LevelMusic(int episode, int map)
+{
+    if (gamemode == commercial)
+    {
+        return mus_runnin + WRAP(map - 1, NUMMUSIC - mus_runnin);
+    }
+    else
+    {
+        return mus_e1m1
+               + WRAP((episode - 1) * 9 + map - 1, mus_runnin - mus_e1m1);
+    }
+}
+
 void S_Start(void)
 {
     int cnum, mnum;
@@ -946,6 +1257,9 @@ void S_Start(void)
         }
     }
 
+    // [Nugget] Voice counters are per level
+    voices_started = voices_dropped = voices_merged = 0;
+
     // [crispy] don't load map's default music if loaded from a savegame with
     // MUSINFO data
     if (musinfo.from_savegame)
@@ -975,16 +1289,7 @@ void S_Start(void)
     }
     else
     {
-        if (gamemode == commercial)
-        {
-            mnum = mus_runnin + WRAP(gamemap - 1, NUMMUSIC - mus_runnin);
-        }
-        else
-        {
-            mnum = mus_e1m1
-                   + WRAP((gameepisode - 1) * 9 + gamemap - 1,
-                          mus_runnin - mus_e1m1);
-        }
+        mnum = LevelMusic(gameepisode, gamemap); // [Nugget]
     }
 
     // [crispy] reset musinfo data at the start of a new map
@@ -1029,6 +1334,176 @@ static void InitE4Music(void)
     }
 }
 
+// [Nugget] /-----------------------------------------------------------------
+
+static void AddPrefetchSound(sfxinfo_t ***list, byte *seen, int sfx_id)
+{
+    sfxinfo_t *sfx;
+
+    if (sfx_id <= 0 || sfx_id >= num_sfx)
+    {
+        return;
+    }
+
+    sfx = &S_sfx[sfx_id];
+
+    while (sfx->link && !(I_GetSfxLumpNum(sfx) >= 0))
+    {
+        sfx = sfx->link; // sf: skip thru link(s)
+    }
+
+    sfx_id = sfx - S_sfx;
+
+    if (!sfx->name || sfx->cached || seen[sfx_id])
+    {
+        return;
+    }
+
+    seen[sfx_id] = true;
+    array_push(*list, sfx);
+}
+
+void S_PrefetchLevelSounds(void)
+{
+    // Heard in most levels regardless of the things in them
+    static const int common_sounds[] = {
+        sfx_pistol, sfx_shotgn, sfx_sgcock, sfx_dshtgn, sfx_dbopn, sfx_dbcls,
+        sfx_dbload, sfx_plasma, sfx_bfg, sfx_sawup, sfx_sawidl, sfx_sawful,
+        sfx_sawhit, sfx_rlaunc, sfx_pstart, sfx_pstop, sfx_doropn, sfx_dorcls,
+        sfx_stnmov, sfx_swtchn, sfx_swtchx, sfx_bdopn, sfx_bdcls, sfx_itemup,
+        sfx_wpnup, sfx_getpow, sfx_oof, sfx_noway, sfx_telept, sfx_slop,
+        sfx_barexp, sfx_punch, sfx_itmbk, sfx_tink,
+    };
+
+    sfxinfo_t **list = NULL;
+    byte *seen;
+
+    if (nosfxparm)
+    {
+        return;
+    }
+
+    seen = calloc(num_sfx, sizeof(*seen));
+
+    for (int i = 0; i < arrlen(common_sounds); i++)
+    {
+        AddPrefetchSound(&list, seen, common_sounds[i]);
+    }
+
+    for (thinker_t *th = thinkercap.next; th != &thinkercap; th = th->next)
+    {
+        if (th->function.p1 == (actionf_p1)P_MobjThinker)
+        {
+            const mobjinfo_t *info = ((mobj_t *)th)->info;
+
+            AddPrefetchSound(&list, seen, info->seesound);
+            AddPrefetchSound(&list, seen, info->attacksound);
+            AddPrefetchSound(&list, seen, info->painsound);
+            AddPrefetchSound(&list, seen, info->deathsound);
+            AddPrefetchSound(&list, seen, info->activesound);
+            AddPrefetchSound(&list, seen, info->ripsound);
+        }
+    }
+
+    I_PrefetchSounds(list, array_size(list));
+
+    array_free(list);
+    free(seen);
+}
+
+// Music lump of the map that normally follows the current one, or -1
+
+static int NextLevelMusicLump(void)
+{
+    int episode = gameepisode, map = gamemap + 1;
+    char namebuf[9];
+
+    if (gamemapinfo && gamemapinfo->nextmap[0])
+    {
+        if (!G_ValidateMapName(gamemapinfo->nextmap, &episode, &map))
+        {
+            return -1;
+        }
+    }
+    else if (gamemode != commercial && gamemap >= 8)
+    {
+        // End of the episode, or a secret level
+        return -1;
+    }
+
+    const mapentry_t *entry = G_LookupMapinfo(episode, map);
+
+    if (entry && entry->music[0])
+    {
+        return W_CheckNumForName(entry->music);
+    }
+
+    if (idmusnum != -1)
+    {
+        return -1;
+    }
+
+    M_snprintf(namebuf, sizeof(namebuf), "d_%s",
+               S_music[LevelMusic(episode, map)].name);
+
+    return W_CheckNumForName(namebuf);
+}
+
+static void PreconvertMusicLump(int lumpnum)
+{
+    // Read into our own buffer, so that the zone tag of the lump, which may
+    // be playing, stays untouched
+    const int length = W_LumpLength(lumpnum);
+    byte header[4];
+    byte *data;
+
+    // Only MUS lumps are converted, so don't read the others
+    if (length <= (int)sizeof(header))
+    {
+        return;
+    }
+
+    W_ReadLumpHeader(lumpnum, header, sizeof(header));
+
+    if (!IsMus(header, length))
+    {
+        return;
+    }
+
+    data = malloc(length);
+    W_ReadLump(lumpnum, data);
+    I_PreconvertMus(data, length);
+    free(data);
+}
+
+void S_PrefetchLevelMusic(void)
+{
+    int lumpnum;
+
+    if (nomusicparm)
+    {
+        return;
+    }
+
+    // Songs the current map may switch to through MUSINFO
+    for (int i = 1; i < MAX_MUS_ENTRIES; i++)
+    {
+        if (musinfo.items[i] > 0)
+        {
+            PreconvertMusicLump(musinfo.items[i]);
+        }
+    }
+
+    lumpnum = NextLevelMusicLump();
+
+    if (lumpnum >= 0)
+    {
+        PreconvertMusicLump(lumpnum);
+    }
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 void S_Init(int sfxVolume, int musicVolume)
 {
     // jff 1/22/98 skip sound init if sound not enabled
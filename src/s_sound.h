@@ -89,6 +89,13 @@ void S_StopSound(const struct mobj_s *origin);
 
 // [FG] play sounds in full length
 extern boolean full_sounds;
+
+// [Nugget] Merge identical sounds started in the same tic nearby
+extern int snd_merge_dist;
+
+// [Nugget] Busy channels, and sounds started, dropped for lack of a channel
+// and merged since the start of the level
+void S_GetVoiceStats(int *active, int *started, int *dropped, int *merged);
 // [FG] removed map objects may finish their sounds
 void S_UnlinkSound(struct mobj_s *origin);
 
@@ -142,6 +149,13 @@ void S_StartSoundPresetOptional(const struct mobj_s *const origin,
 void S_StartSoundHitFloorOptional(const struct mobj_s *const origin,
                                   const int opt_sound_id, const int sound_id);
 
+// Decode the sounds used by the level's things in the background
+void S_PrefetchLevelSounds(void);
+
+// Convert the songs the level may switch to, and the next level's, in the
+// background
+void S_PrefetchLevelMusic(void);
+
 #endif
 
 //----------------------------------------------------------------------------
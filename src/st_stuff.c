@@ -1364,55 +1364,50 @@ static void ResetStatusBar(void)
 
 static boolean draw_shadow = false; // [Nugget] HUD/menu shadows
 
-// [Nugget] Extended to accept two colorings
-static void DrawPatchEx(int x, int y, int maxheight, sbaralignment_t alignment,
-                        patch_t *patch, crange_idx_e cr, crange_idx_e cr2, byte *tl)
+// [Nugget] Retained status bar /---------------------------------------------
+
+// The bar is only rasterized again when what would be drawn on it changes;
+// otherwise, the last result is copied over the background in one go
+
+static boolean st_retained_bar;
+
+typedef struct
 {
-    if (!patch)
-    {
-        return;
-    }
+    int x, y;
+    patch_t *patch;
+    byte *outr, *outr2, *tl;
+    boolean shadow;
+    boolean plain; // V_DrawPatch()
+} stdrawcmd_t;
 
-    int width = SHORT(patch->width);
-    int height = maxheight ? maxheight : SHORT(patch->height);
+static pixel_t *st_retained_screen = NULL;
+static boolean st_retained_valid;
 
-    if (alignment & sbe_h_middle)
-    {
-        x = x - width / 2 + SHORT(patch->leftoffset);
-    }
-    else if (alignment & sbe_h_right)
-    {
-        x -= width;
-    }
+// Drawn directly, after the bar
+static sbarelem_t *st_carousel_elem;
+static int st_carousel_x, st_carousel_y;
 
-    if (alignment & sbe_v_middle)
-    {
-        y = y - height / 2 + SHORT(patch->topoffset);
-    }
-    else if (alignment & sbe_v_bottom)
-    {
-        y -= height;
-    }
+static boolean st_recording;
+static boolean st_straddling; // Some patch is partly on the bar
 
-    if (st_layout == st_wide
-        || (st_nughud && alignment & sbe_wide_force)) // [Nugget] NUGHUD
+// Patches on the bar in this frame, and in the one last rasterized
+static stdrawcmd_t *st_cmds, *st_retained_cmds;
+
+static void RasterizePatch(const stdrawcmd_t *cmd)
+{
+    const int x = cmd->x, y = cmd->y;
+    patch_t *const patch = cmd->patch;
+    byte *const outr = cmd->outr, *const outr2 = cmd->outr2, *const tl = cmd->tl;
+
+    if (cmd->plain)
     {
-        if (alignment & sbe_wide_left)
-        {
-            x -= video.deltaw;
-        }
-        if (alignment & sbe_wide_right)
-        {
-            x += video.deltaw;
-        }
+        V_DrawPatch(x, y, patch);
+        return;
     }
 
-    byte *outr = colrngs[cr];
-    byte *outr2 = colrngs[cr2]; // [Nugget]
-
     // [Nugget] HUD/menu shadows
 
-    V_ToggleShadows(draw_shadow);
+    V_ToggleShadows(cmd->shadow);
 
     if (outr && outr2)
     {
@@ -1448,6 +1443,112 @@ static void DrawPatchEx(int x, int y, int maxheight, sbaralignment_t alignment,
     V_ToggleShadows(true);
 }
 
+static void SubmitPatch(const stdrawcmd_t *cmd)
+{
+    if (st_recording)
+    {
+        const int top = cmd->y - SHORT(cmd->patch->topoffset),
+                  bottom = top + SHORT(cmd->patch->height) + 1; // Shadow
+
+        if (top >= ST_Y)
+        {
+            array_push(st_cmds, *cmd);
+            return;
+        }
+        else if (bottom > ST_Y)
+        {
+            st_straddling = true;
+            array_push(st_cmds, *cmd);
+            return;
+        }
+    }
+
+    RasterizePatch(cmd);
+}
+
+static void DrawPlainPatch(int x, int y, patch_t *patch)
+{
+    SubmitPatch(&(stdrawcmd_t){ .x = x, .y = y, .patch = patch, .plain = true });
+}
+
+static boolean SameCommands(const stdrawcmd_t *a, const stdrawcmd_t *b)
+{
+    if (array_size(a) != array_size(b))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < array_size(a); i++)
+    {
+        if (a[i].x != b[i].x || a[i].y != b[i].y || a[i].patch != b[i].patch
+            || a[i].outr != b[i].outr || a[i].outr2 != b[i].outr2
+            || a[i].tl != b[i].tl || a[i].shadow != b[i].shadow
+            || a[i].plain != b[i].plain)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
+// [Nugget] Extended to accept two colorings
+static void DrawPatchEx(int x, int y, int maxheight, sbaralignment_t alignment,
+                        patch_t *patch, crange_idx_e cr, crange_idx_e cr2, byte *tl)
+{
+    if (!patch)
+    {
+        return;
+    }
+
+    int width = SHORT(patch->width);
+    int height = maxheight ? maxheight : SHORT(patch->height);
+
+    if (alignment & sbe_h_middle)
+    {
+        x = x - width / 2 + SHORT(patch->leftoffset);
+    }
+    else if (alignment & sbe_h_right)
+    {
+        x -= width;
+    }
+
+    if (alignment & sbe_v_middle)
+    {
+        y = y - height / 2 + SHORT(patch->topoffset);
+    }
+    else if (alignment & sbe_v_bottom)
+    {
+        y -= height;
+    }
+
+    if (st_layout == st_wide
+        || (st_nughud && alignment & sbe_wide_force)) // [Nugget] NUGHUD
+    {
+        if (alignment & sbe_wide_left)
+        {
+            x -= video.deltaw;
+        }
+        if (alignment & sbe_wide_right)
+        {
+            x += video.deltaw;
+        }
+    }
+
+    // [Nugget] Retained status bar
+    SubmitPatch(&(stdrawcmd_t){
+        .x = x,
+        .y = y,
+        .patch = patch,
+        .outr = colrngs[cr],
+        .outr2 = colrngs[cr2],
+        .tl = tl,
+        .shadow = draw_shadow && hud_menu_shadows,
+    });
+}
+
 // [Nugget]
 #define DrawPatch(x, y, mh, a, p, cr, tl) \
   DrawPatchEx(x, y, mh, a, p, cr, CR_NONE, tl)
@@ -1728,7 +1829,17 @@ static void DrawElem(int x, int y, sbarelem_t *elem, player_t *player)
         case sbe_carousel:
             if (weapon_carousel)
             {
-                ST_DrawCarousel(x, y, elem);
+                // [Nugget] Retained status bar: draw it over the bar
+                if (st_recording)
+                {
+                    st_carousel_x = x;
+                    st_carousel_y = y;
+                    st_carousel_elem = elem;
+                }
+                else
+                {
+                    ST_DrawCarousel(x, y, elem);
+                }
             }
             break;
 
@@ -1798,7 +1909,8 @@ static void DrawSolidBackground(void)
 
 static boolean st_refresh_background = true; // [Nugget] Static
 
-static void DrawBackground(const char *name)
+// [Nugget] Split from DrawBackground()
+static void RefreshBackground(const char *name)
 {
     if (st_refresh_background)
     {
@@ -1833,7 +1945,13 @@ static void DrawBackground(const char *name)
         V_RestoreBuffer();
 
         st_refresh_background = false;
+        st_retained_valid = false; // [Nugget] Retained status bar
     }
+}
+
+static void DrawBackground(const char *name)
+{
+    RefreshBackground(name); // [Nugget]
 
     V_CopyRect(0, 0, st_backing_screen, video.unscaledw, ST_HEIGHT, 0, ST_Y);
 }
@@ -1846,11 +1964,70 @@ static void DrawCenteredMessage(void)
     }
 }
 
+// [Nugget] Retained status bar: rasterizes the patches recorded on the bar
+// if they changed, and copies the result to the screen
+static void CompositeStatusBar(void)
+{
+    if (st_straddling)
+    {
+        DrawBackground(statusbar->fillflat);
+
+        for (int i = 0; i < array_size(st_cmds); i++)
+        {
+            RasterizePatch(&st_cmds[i]);
+        }
+
+        st_retained_valid = false;
+    }
+    else
+    {
+        RefreshBackground(statusbar->fillflat);
+
+        if (!st_retained_valid || menuactive
+            || !SameCommands(st_cmds, st_retained_cmds))
+        {
+            stdrawcmd_t *const temp = st_retained_cmds;
+
+            V_UseBuffer(st_retained_screen);
+
+            V_CopyRect(0, 0, st_backing_screen, video.unscaledw, ST_HEIGHT,
+                       0, ST_Y);
+
+            for (int i = 0; i < array_size(st_cmds); i++)
+            {
+                RasterizePatch(&st_cmds[i]);
+            }
+
+            V_RestoreBuffer();
+
+            st_retained_cmds = st_cmds;
+            st_cmds = temp;
+            st_retained_valid = true;
+        }
+
+        V_CopyRect(0, ST_Y, st_retained_screen, video.unscaledw, ST_HEIGHT,
+                   0, ST_Y);
+    }
+
+    array_clear(st_cmds);
+
+    if (st_carousel_elem)
+    {
+        ST_DrawCarousel(st_carousel_x, st_carousel_y, st_carousel_elem);
+        st_carousel_elem = NULL;
+    }
+}
+
 static void DrawStatusBar(void)
 {
     player_t *player = &players[displayplayer];
 
-    if (!statusbar->fullscreenrender)
+    // [Nugget] Retained status bar
+    st_recording = st_retained_bar && !statusbar->fullscreenrender
+                   && !st_nughud;
+    st_straddling = false;
+
+    if (!statusbar->fullscreenrender && !st_recording) // [Nugget]
     {
         DrawBackground(statusbar->fillflat);
     }
@@ -1884,19 +2061,19 @@ static void DrawStatusBar(void)
             // NUGHUD Berserk
             if (st_nughud && nhbersrk)
             {
-                V_DrawPatch(ammox, ammoy, nhbersrk);
+                DrawPlainPatch(ammox, ammoy, nhbersrk);
             }
             // Status Bar Berserk
             else if (stbersrk)
             {
-                V_DrawPatch(ammox, ammoy, stbersrk);
+                DrawPlainPatch(ammox, ammoy, stbersrk);
             }
             // Berserk or Medkit sprite
             else if (lu_berserk >= 0)
             {
                 patch_t *const patch = V_CachePatchNum(lu_berserk, PU_STATIC);
                 
-                V_DrawPatch(
+                DrawPlainPatch(
                     ammox - (21 * ((st_ammo_elem->alignment & sbe_h_mask) - 1))
                     - SHORT(patch->width)/2 + SHORT(patch->leftoffset),
                     ammoy + 8 - SHORT(patch->height)/2 + SHORT(patch->topoffset),
@@ -1907,14 +2084,21 @@ static void DrawStatusBar(void)
         // NUGHUD Infinity
         else if (st_nughud && nhinfnty)
         {
-            V_DrawPatch(ammox, ammoy, nhinfnty);
+            DrawPlainPatch(ammox, ammoy, nhinfnty);
         }
         // Status Bar Infinity
         else if (stinfnty)
         {
-            V_DrawPatch(ammox, ammoy, stinfnty);
+            DrawPlainPatch(ammox, ammoy, stinfnty);
         }
     }
+
+    // [Nugget] Retained status bar
+    if (st_recording)
+    {
+        st_recording = false;
+        CompositeStatusBar();
+    }
 }
 
 static void EraseElem(int x, int y, sbarelem_t *elem, player_t *player)
@@ -2387,6 +2571,12 @@ void ST_InitRes(void)
   // [Nugget] Status-Bar chunks
   // More than necessary (we only use the section visible in 4:3), but so be it
   st_bar = Z_Malloc((video.pitch * V_ScaleY(stbar_height)) * sizeof(*st_bar), PU_RENDERER, 0);
+
+  // [Nugget] Retained status bar: full-screen, so that it can be drawn to at
+  // the same coordinates as the screen
+  st_retained_screen = Z_Malloc(video.pitch * video.height * sizeof(*st_retained_screen),
+                                PU_RENDERER, 0);
+  st_retained_valid = false;
 }
 
 void ST_ResetPalette(void)
@@ -3666,6 +3856,10 @@ void ST_BindSTSVariables(void)
   M_BindBool("hud_blink_keys", &hud_blink_keys, NULL, false, ss_stat, wad_yes,
              "Make missing keys blink when trying to trigger linedef actions");
 
+  // (CFG-only)
+  M_BindBool("st_retained_bar", &st_retained_bar, NULL, true, ss_none, wad_no,
+             "Only redraw the status bar when its contents change");
+
   // [Nugget] ---------------------------------------------------------------/
 
   M_BindNum("health_red", &health_red, NULL, 25, 0, 200, ss_none, wad_yes,
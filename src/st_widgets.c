@@ -36,6 +36,7 @@
 #include "m_misc.h"
 #include "p_mobj.h"
 #include "p_spec.h"
+#include "r_data.h"
 #include "r_main.h"
 #include "r_voxel.h"
 #include "s_sound.h"
@@ -47,6 +48,7 @@
 
 // [Nugget]
 #include "m_nughud.h"
+#include "m_perf.h"
 #include "st_stuff.h"
 #include "z_zone.h"
 
@@ -1255,6 +1257,43 @@ static void UpdateRate(sbe_widget_t *widget, player_t *player)
                    rendered_voxels);
         ST_AddLine(widget, line2);
     }
+
+    // [Nugget] Frame-time breakdown
+    if (hud_frame_timings)
+    {
+        static char lines[NUMPERFSTAGES][60];
+
+        for (int i = 0; i < NUMPERFSTAGES; i++)
+        {
+            M_snprintf(lines[i], sizeof(lines[i]),
+                       GRAY_S " %-7s " GREEN_S "%6.2f %6.2f %6.2f ms",
+                       M_PerfStageName(i),
+                       M_PerfPercentile(i, 50) / 1000.0,
+                       M_PerfPercentile(i, 95) / 1000.0,
+                       M_PerfPercentile(i, 99) / 1000.0);
+            ST_AddLine(widget, lines[i]);
+        }
+
+        static char cacheline[60];
+        size_t bytes;
+        int hits, misses;
+
+        R_GetCompositeCacheStats(&bytes, &hits, &misses);
+        M_snprintf(cacheline, sizeof(cacheline),
+                   GRAY_S " Textures " GREEN_S "%.1f MiB %d hits %d misses",
+                   bytes / (1024.0 * 1024.0), hits, misses);
+        ST_AddLine(widget, cacheline);
+
+        static char soundline[60];
+        int active, started, dropped, merged;
+
+        S_GetVoiceStats(&active, &started, &dropped, &merged);
+        M_snprintf(soundline, sizeof(soundline),
+                   GRAY_S " Sounds " GREEN_S "%d/%d %d started %d dropped "
+                          "%d merged",
+                   active, snd_channels, started, dropped, merged);
+        ST_AddLine(widget, soundline);
+    }
 }
 
 int speedometer;
@@ -1631,6 +1670,9 @@ void ST_BindHUDVariables(void)
             ss_stat, wad_no,
             "Show powerup-timers widget (1 = On automap; 2 = On HUD; 3 = Always)");
 
+  M_BindBool("hud_frame_timings", &hud_frame_timings, NULL, false, ss_none, wad_no,
+             "Show per-stage frame times (p50, p95, p99) in the rendering-stats widget");
+
   // [Nugget] ---------------------------------------------------------------/
 
   // [Nugget]
@@ -22,6 +22,7 @@
 //-----------------------------------------------------------------------------
 
 #include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -32,6 +33,7 @@
 #include "i_system.h"
 #include "i_video.h"
 #include "m_argv.h"
+#include "m_array.h"
 #include "m_io.h"
 #include "m_misc.h"
 #include "m_swap.h"
@@ -551,6 +553,428 @@ static void DrawPatchInternal(int x, int y, patch_t *patch, boolean flipped)
     }
 }
 
+// [Nugget] Pre-scaled patches /----------------------------------------------
+
+// Menu, HUD and font patches are mostly drawn at the same place, frame after
+// frame. The second time, the scaled and translated result is recorded, and
+// is then copied row by row, which also spares the column-wise writes.
+// Scaling steps vary across the screen, so the position is part of the key;
+// patches that move every frame never get past the first sighting.
+
+boolean patch_raster_cache;
+
+#define PATCH_RASTER_BUCKETS 1024
+#define PATCH_RASTER_BUDGET (32 << 20)
+
+// Keys seen once, that don't have a raster yet
+#define PATCH_RASTER_MAX_SIGHTINGS 4096
+
+// Larger patches, like fullscreen ones, are drawn too rarely to be kept
+#define PATCH_RASTER_MAX_AREA (128 * 128)
+
+typedef struct
+{
+    int row, x, length;
+} rasterspan_t;
+
+typedef struct patchraster_s
+{
+    struct patchraster_s *next;
+
+    // Key
+    const patch_t *patch;
+    int x, y, crop;
+    boolean flipped;
+    const byte *tr1, *tr2;
+
+    // `z_free_generation` when the patch was last known to be the same one,
+    // and the hash of its contents to tell so again after blocks were freed;
+    // hashed only once the raster is recorded
+    unsigned int generation;
+    uint32_t hash;
+
+    // Screen-space bounding box, and the opaque runs within it; `pixels`
+    // is NULL for keys seen only once so far
+    int left, top, width;
+    byte *pixels;
+    rasterspan_t *spans;
+    int numspans;
+    size_t bytes;
+} patchraster_t;
+
+static patchraster_t *patch_rasters[PATCH_RASTER_BUCKETS];
+static size_t patch_raster_bytes;
+static int patch_raster_sightings;
+
+// Set by every V_DrawPatch*() variant: the translations that make up the
+// drawn color, and the translucency map it's blended with
+static const byte *raster_tr1, *raster_tr2, *raster_tl;
+
+typedef struct
+{
+    int x, y1, count, offset;
+} recordedcol_t;
+
+static recordedcol_t *recorded_cols;
+static byte *recorded_pixels;
+
+static void SetRasterColors(const byte *tr1, const byte *tr2, const byte *tl)
+{
+    raster_tr1 = tr1;
+    raster_tr2 = tr2;
+    raster_tl = tl;
+}
+
+static void RecordPatchColumn(const patch_column_t *patchcol)
+{
+    const int count = patchcol->y2 - patchcol->y1 + 1;
+
+    if (count <= 0)
+    {
+        return;
+    }
+
+    if ((unsigned int)patchcol->x >= (unsigned int)video.width
+        || (unsigned int)patchcol->y1 >= (unsigned int)video.height)
+    {
+        I_Error("RecordPatchColumn: %i to %i at %i", patchcol->y1,
+                patchcol->y2, patchcol->x);
+    }
+
+    const fixed_t fracstep = patchcol->step;
+    fixed_t frac = patchcol->frac + ((patchcol->y1 * fracstep) & FRACMASK);
+
+    array_push(recorded_cols, ((recordedcol_t){patchcol->x, patchcol->y1,
+                                               count,
+                                               array_size(recorded_pixels)}));
+
+    for (int i = 0; i < count; i++, frac += fracstep)
+    {
+        byte pixel = patchcol->source[frac >> FRACBITS];
+
+        if (raster_tr1)
+        {
+            pixel = raster_tr1[pixel];
+        }
+
+        if (raster_tr2)
+        {
+            pixel = raster_tr2[pixel];
+        }
+
+        array_push(recorded_pixels, pixel);
+    }
+}
+
+// Patches can be purged and others loaded at the same address
+static uint32_t PatchHash(const patch_t *patch)
+{
+    const int w = SHORT(patch->width);
+    uint32_t hash = 2166136261u;
+
+    hash = (hash ^ (uint16_t)SHORT(patch->width)) * 16777619u;
+    hash = (hash ^ (uint16_t)SHORT(patch->height)) * 16777619u;
+    hash = (hash ^ (uint16_t)SHORT(patch->leftoffset)) * 16777619u;
+    hash = (hash ^ (uint16_t)SHORT(patch->topoffset)) * 16777619u;
+
+    for (int c = 0; c < w; c++)
+    {
+        const column_t *column =
+            (const column_t *)((const byte *)patch + LONG(patch->columnofs[c]));
+
+        for (; column->topdelta != 0xff;
+             column = (const column_t *)((const byte *)column + column->length + 4))
+        {
+            const byte *source = (const byte *)column + 3;
+
+            hash = (hash ^ column->topdelta) * 16777619u;
+            hash = (hash ^ column->length) * 16777619u;
+
+            for (int i = 0; i < column->length; i++)
+            {
+                hash = (hash ^ source[i]) * 16777619u;
+            }
+        }
+
+        hash = (hash ^ 0xff) * 16777619u;
+    }
+
+    return hash;
+}
+
+static void FlushPatchRasters(void)
+{
+    for (int i = 0; i < PATCH_RASTER_BUCKETS; i++)
+    {
+        while (patch_rasters[i])
+        {
+            patchraster_t *next = patch_rasters[i]->next;
+
+            free(patch_rasters[i]->pixels);
+            free(patch_rasters[i]->spans);
+            free(patch_rasters[i]);
+
+            patch_rasters[i] = next;
+        }
+    }
+
+    patch_raster_bytes = 0;
+    patch_raster_sightings = 0;
+}
+
+// Drops the keys that were seen only once, so that moving patches don't
+// pile up in the buckets
+static void FlushPatchSightings(void)
+{
+    for (int i = 0; i < PATCH_RASTER_BUCKETS; i++)
+    {
+        patchraster_t **link = &patch_rasters[i];
+
+        while (*link)
+        {
+            patchraster_t *raster = *link;
+
+            if (raster->pixels)
+            {
+                link = &raster->next;
+                continue;
+            }
+
+            *link = raster->next;
+            free(raster);
+        }
+    }
+
+    patch_raster_bytes -= patch_raster_sightings * sizeof(patchraster_t);
+    patch_raster_sightings = 0;
+}
+
+// Fills in the raster of a key seen before, returning false if nothing
+// would be drawn
+static boolean BuildPatchRaster(patchraster_t *raster)
+{
+    int left = INT_MAX, right = INT_MIN, top = INT_MAX, bottom = INT_MIN;
+    int width, height;
+    byte *mask;
+    rasterspan_t *spans = NULL;
+
+    for (int i = 0; i < array_size(recorded_cols); i++)
+    {
+        const recordedcol_t *col = &recorded_cols[i];
+
+        left = MIN(left, col->x);
+        right = MAX(right, col->x);
+        top = MIN(top, col->y1);
+        bottom = MAX(bottom, col->y1 + col->count - 1);
+    }
+
+    if (left > right)
+    {
+        return false;
+    }
+
+    width = right - left + 1;
+    height = bottom - top + 1;
+
+    raster->left = left;
+    raster->top = top;
+    raster->width = width;
+    raster->pixels = malloc(width * height);
+    mask = calloc(width, height);
+
+    for (int i = 0; i < array_size(recorded_cols); i++)
+    {
+        const recordedcol_t *col = &recorded_cols[i];
+        const int offset = (col->y1 - top) * width + (col->x - left);
+
+        for (int j = 0; j < col->count; j++)
+        {
+            raster->pixels[offset + j * width] =
+                recorded_pixels[col->offset + j];
+            mask[offset + j * width] = 1;
+        }
+    }
+
+    for (int row = 0; row < height; row++)
+    {
+        const byte *m = mask + row * width;
+
+        for (int x = 0; x < width;)
+        {
+            if (!m[x])
+            {
+                x++;
+                continue;
+            }
+
+            const int start = x;
+
+            while (x < width && m[x])
+            {
+                x++;
+            }
+
+            array_push(spans, ((rasterspan_t){row, start, x - start}));
+        }
+    }
+
+    free(mask);
+
+    // Copied out of the dynamic array, which over-allocates
+    raster->numspans = array_size(spans);
+    raster->spans = malloc(raster->numspans * sizeof(*raster->spans));
+    memcpy(raster->spans, spans, raster->numspans * sizeof(*raster->spans));
+    array_free(spans);
+
+    raster->bytes = width * height + raster->numspans * sizeof(*raster->spans);
+    patch_raster_bytes += raster->bytes;
+    patch_raster_sightings--;
+
+    return true;
+}
+
+// Back to a key seen once
+static void ResetPatchRaster(patchraster_t *raster)
+{
+    if (raster->pixels)
+    {
+        free(raster->pixels);
+        free(raster->spans);
+        raster->pixels = NULL;
+        raster->spans = NULL;
+        raster->numspans = 0;
+
+        patch_raster_bytes -= raster->bytes;
+        patch_raster_sightings++;
+    }
+}
+
+static void BlitPatchRaster(const patchraster_t *raster)
+{
+    const byte *const tl = raster_tl;
+
+    for (int i = 0; i < raster->numspans; i++)
+    {
+        const rasterspan_t *span = &raster->spans[i];
+        const byte *src = raster->pixels + span->row * raster->width + span->x;
+        byte *dest = V_ADDRESS(dest_screen, raster->left + span->x,
+                               raster->top + span->row);
+
+        if (tl)
+        {
+            for (int j = 0; j < span->length; j++)
+            {
+                dest[j] = tl[(dest[j] << 8) + src[j]];
+            }
+        }
+        else
+        {
+            memcpy(dest, src, span->length);
+        }
+    }
+}
+
+static void DrawPatchCached(int x, int y, patch_t *patch, boolean flipped)
+{
+    const int crop = drawingshadow ? shadowcrop : 0;
+    unsigned int bucket;
+    patchraster_t *raster;
+
+    if (!patch_raster_cache
+        || SHORT(patch->width) * SHORT(patch->height) > PATCH_RASTER_MAX_AREA)
+    {
+        DrawPatchInternal(x, y, patch, flipped);
+        return;
+    }
+
+    bucket = (((uintptr_t)patch >> 4) ^ (x * 31) ^ (y * 131)
+              ^ ((uintptr_t)raster_tr1 >> 8) ^ ((uintptr_t)raster_tr2 >> 8))
+             % PATCH_RASTER_BUCKETS;
+
+    for (raster = patch_rasters[bucket]; raster; raster = raster->next)
+    {
+        if (raster->patch == patch && raster->x == x && raster->y == y
+            && raster->crop == crop && raster->flipped == flipped
+            && raster->tr1 == raster_tr1 && raster->tr2 == raster_tr2)
+        {
+            break;
+        }
+    }
+
+    // A block may have been reused for another patch since the key was
+    // seen; only then are the contents hashed again
+    if (raster && raster->generation != z_free_generation)
+    {
+        raster->generation = z_free_generation;
+
+        // Only keys with a raster have had their contents hashed
+        if (!raster->pixels || raster->hash != PatchHash(patch))
+        {
+            // Maybe another patch, seen for the first time
+            ResetPatchRaster(raster);
+            DrawPatchInternal(x, y, patch, flipped);
+            return;
+        }
+    }
+
+    if (raster && raster->pixels)
+    {
+        BlitPatchRaster(raster);
+        return;
+    }
+
+    if (!raster)
+    {
+        // First sighting: remember the key, but draw as usual
+        if (patch_raster_bytes > PATCH_RASTER_BUDGET)
+        {
+            FlushPatchRasters();
+        }
+        else if (patch_raster_sightings >= PATCH_RASTER_MAX_SIGHTINGS)
+        {
+            FlushPatchSightings();
+        }
+
+        raster = calloc(1, sizeof(*raster));
+        raster->patch = patch;
+        raster->x = x;
+        raster->y = y;
+        raster->crop = crop;
+        raster->flipped = flipped;
+        raster->tr1 = raster_tr1;
+        raster->tr2 = raster_tr2;
+        raster->generation = z_free_generation;
+
+        raster->next = patch_rasters[bucket];
+        patch_rasters[bucket] = raster;
+
+        patch_raster_bytes += sizeof(*raster);
+        patch_raster_sightings++;
+
+        DrawPatchInternal(x, y, patch, flipped);
+        return;
+    }
+
+    // Seen before: record what would be drawn, at the same coordinates
+    void (*const colfunc)(const patch_column_t *) = drawcolfunc;
+
+    raster->hash = PatchHash(patch);
+
+    array_clear(recorded_cols);
+    array_clear(recorded_pixels);
+
+    drawcolfunc = RecordPatchColumn;
+    DrawPatchInternal(x, y, patch, flipped);
+    drawcolfunc = colfunc;
+
+    if (BuildPatchRaster(raster))
+    {
+        BlitPatchRaster(raster);
+    }
+}
+
+// [Nugget] -----------------------------------------------------------------/
+
 //
 // V_DrawPatch
 //
@@ -575,8 +999,9 @@ void V_DrawPatchGeneral(int x, int y, patch_t *patch, boolean flipped)
     x += video.deltaw;
 
     drawcolfunc = DrawPatchColumn;
+    SetRasterColors(NULL, NULL, NULL); // [Nugget]
 
-    DrawPatchInternal(x, y, patch, flipped);
+    DrawPatchCached(x, y, patch, flipped); // [Nugget]
 }
 
 void V_DrawPatchTranslated(int x, int y, patch_t *patch, byte *outr)
@@ -593,7 +1018,9 @@ void V_DrawPatchTranslated(int x, int y, patch_t *patch, byte *outr)
         drawcolfunc = DrawPatchColumn;
     }
 
-    DrawPatchInternal(x, y, patch, false);
+    SetRasterColors(outr, NULL, NULL); // [Nugget]
+
+    DrawPatchCached(x, y, patch, false); // [Nugget]
 }
 
 void V_DrawPatchTL(int x, int y, struct patch_s *patch, byte *tl)
@@ -602,8 +1029,9 @@ void V_DrawPatchTL(int x, int y, struct patch_s *patch, byte *tl)
 
     tranmap = tl;
     drawcolfunc = DrawPatchColumnTL;
+    SetRasterColors(NULL, NULL, tl); // [Nugget]
 
-    DrawPatchInternal(x, y, patch, false);
+    DrawPatchCached(x, y, patch, false); // [Nugget]
 }
 
 void V_DrawPatchTRTL(int x, int y, struct patch_s *patch, byte *outr, byte *tl)
@@ -613,8 +1041,9 @@ void V_DrawPatchTRTL(int x, int y, struct patch_s *patch, byte *outr, byte *tl)
     translation = outr;
     tranmap = tl;
     drawcolfunc = DrawPatchColumnTRTL;
+    SetRasterColors(outr, NULL, tl); // [Nugget]
 
-    DrawPatchInternal(x, y, patch, false);
+    DrawPatchCached(x, y, patch, false); // [Nugget]
 }
 
 void V_DrawPatchTRTR(int x, int y, patch_t *patch, byte *outr1, byte *outr2)
@@ -624,8 +1053,9 @@ void V_DrawPatchTRTR(int x, int y, patch_t *patch, byte *outr1, byte *outr2)
     translation1 = outr1;
     translation2 = outr2;
     drawcolfunc = DrawPatchColumnTRTR;
+    SetRasterColors(outr1, outr2, NULL); // [Nugget]
 
-    DrawPatchInternal(x, y, patch, false);
+    DrawPatchCached(x, y, patch, false); // [Nugget]
 }
 
 // [Nugget] /-----------------------------------------------------------------
@@ -639,8 +1069,9 @@ void V_DrawPatchTRTRTL(int x, int y, struct patch_s *patch,
     translation2 = outr2;
     tranmap = tl;
     drawcolfunc = DrawPatchColumnTRTRTL;
+    SetRasterColors(outr1, outr2, tl);
 
-    DrawPatchInternal(x, y, patch, false);
+    DrawPatchCached(x, y, patch, false);
 }
 
 void V_DrawPatchTranslucent2(int x, int y, struct patch_s *patch, boolean flipped,
@@ -660,7 +1091,10 @@ void V_DrawPatchTranslucent2(int x, int y, struct patch_s *patch, boolean flippe
     drawcolfunc = DrawPatchColumnTranslucent2;
     tranmap = tmap;
 
-    DrawPatchInternal(x, y, patch, flipped);
+    // Same precedence as the column drawer
+    SetRasterColors(translation1, translation1 ? translation2 : NULL, tmap);
+
+    DrawPatchCached(x, y, patch, flipped);
 }
 
 void V_DrawPatchShadowed(int x, int y, struct patch_s *patch, boolean flipped,
@@ -1124,6 +1558,8 @@ void V_Init(void)
 {
     fixed_t frac, lastfrac;
 
+    FlushPatchRasters(); // [Nugget] Scaled for the old resolution
+
     linesize = video.pitch;
 
     video.xscale = (video.width << FRACBITS) / video.unscaledw;
@@ -1178,6 +1614,22 @@ void V_RestoreBuffer(void)
     dest_screen = I_VideoBuffer;
 }
 
+// [Nugget] Split from V_ScreenShot()
+static void ReportScreenShot(boolean success)
+{
+    // 1/18/98 killough: replace "SCREEN SHOT" acknowledgement with sfx
+    // players[consoleplayer].message = "screen shot"
+
+    // killough 10/98: print error message and change sound effect if error
+    S_StartSoundPitch(NULL,
+                 !success
+                 ? displaymsg("%s", errno ? strerror(errno)
+                                          : "Could not take screenshot"),
+                 sfx_oof
+                 : gamemode == commercial ? sfx_radio
+                                          : sfx_tink, PITCH_NONE);
+}
+
 //
 // V_ScreenShot
 //
@@ -1212,14 +1664,9 @@ void V_ScreenShot(void)
 
         if (tries)
         {
-            // killough 10/98: detect failure and remove file if error
             // killough 11/98: add hires support
-            if (!(success = I_WritePNGfile(screenshotname))) // [FG] PNG
-            {
-                int t = errno;
-                M_remove(screenshotname);
-                errno = t;
-            }
+            // [Nugget] Written in the background, see V_ScreenShotDone()
+            success = I_WritePNGfile(screenshotname); // [FG] PNG
         }
         if (screenshotname)
         {
@@ -1227,17 +1674,23 @@ void V_ScreenShot(void)
         }
     }
 
-    // 1/18/98 killough: replace "SCREEN SHOT" acknowledgement with sfx
-    // players[consoleplayer].message = "screen shot"
+    if (!success)
+    {
+        ReportScreenShot(false);
+    }
+}
 
-    // killough 10/98: print error message and change sound effect if error
-    S_StartSoundPitch(NULL,
-                 !success
-                 ? displaymsg("%s", errno ? strerror(errno)
-                                          : "Could not take screenshot"),
-                 sfx_oof
-                 : gamemode == commercial ? sfx_radio
-                                          : sfx_tink, PITCH_NONE);
+// [Nugget] Called once a screenshot has been written, or failed to be
+void V_ScreenShotDone(const char *filename, boolean success, int error)
+{
+    // killough 10/98: detect failure and remove file if error
+    if (!success)
+    {
+        M_remove(filename);
+    }
+
+    errno = error;
+    ReportScreenShot(success);
 }
 
 //----------------------------------------------------------------------------
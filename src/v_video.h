@@ -194,6 +194,10 @@ extern int hud_menu_shadows_filter_pct;
 void V_ToggleShadows(const boolean on);
 void V_SetShadowCrop(const int value);
 
+// Pre-scaled patches --------------------------------------------------------
+
+extern boolean patch_raster_cache;
+
 // ---------------------------------------------------------------------------
 
 void V_DrawPatchTRTRTL(int x, int y, struct patch_s *patch,
@@ -280,6 +284,7 @@ void V_ShadeScreen(const int level); // [Nugget]
 int V_BloodColor(int blood);
 
 void V_ScreenShot(void);
+void V_ScreenShotDone(const char *filename, boolean success, int error); // [Nugget]
 
 #endif
 
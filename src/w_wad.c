@@ -518,6 +518,41 @@ void W_ReadLump(int lump, void *dest)
     I_EndRead();
 }
 
+// [Nugget] Loads the first `size` bytes of the lump, which must be at least
+// that long, without reading the rest of it where possible
+
+void W_ReadLumpHeader(int lump, void *dest, int size)
+{
+    lumpinfo_t *info = lumpinfo + lump;
+
+#ifdef RANGECHECK
+    if (lump >= numlumps || size > info->size)
+    {
+        I_Error("W_ReadLumpHeader: %i bytes of lump %i", size, lump);
+    }
+#endif
+
+    if (info->data)
+    {
+        memcpy(dest, info->data, size);
+    }
+    else if (info->module == &w_zip_module)
+    {
+        // Archived lumps can only be extracted whole
+        byte *buffer = malloc(info->size);
+
+        W_ReadLump(lump, buffer);
+        memcpy(dest, buffer, size);
+        free(buffer);
+    }
+    else if (size > 0)
+    {
+        I_BeginRead(size);
+        info->module->Read(info->handle, dest, size);
+        I_EndRead();
+    }
+}
+
 //
 // W_CacheLumpNum
 //
@@ -50,6 +50,8 @@ static const size_t HEADER_SIZE = (sizeof(memblock_t)+CHUNK_SIZE-1) & ~(CHUNK_SI
 
 static memblock_t *blockbytag[PU_MAX];
 
+unsigned int z_free_generation; // [Nugget]
+
 // Z_Malloc
 // You can pass a NULL user if the tag is < PU_CACHE.
 
@@ -108,6 +110,11 @@ void Z_Free(void *p)
   if (block->user)            // Nullify user if one exists
     *block->user = NULL;
 
+  // [Nugget] Thinkers and other level data are freed all the time, and are
+  // never lumps
+  if (block->tag != PU_LEVEL)
+    z_free_generation++;
+
   if (block == block->next)
     blockbytag[block->tag] = NULL;
   else
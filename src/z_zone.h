@@ -42,6 +42,10 @@ typedef enum {
 
 #define PU_LEVSPEC PU_LEVEL
 
+// [Nugget] Bumped when a block that may hold a lump is freed, so that caches
+// keyed on addresses can tell when one may have been reused
+extern unsigned int z_free_generation;
+
 void *Z_Malloc(size_t size, pu_tag tag, void **ptr);
 void Z_Free(void *ptr);
 void Z_FreeTag(pu_tag tag);